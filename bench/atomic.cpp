@@ -0,0 +1,97 @@
+#include "suite.h"
+
+#include "shared-from-this/atomic_shared.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+using bench::Payload;
+
+// A slot that every thread reads, with the first thread replacing the object now and then
+constexpr size_t kStoreEvery = 64;
+
+struct LockFreeSlot {
+    using Ptr = SharedPtr<Payload>;
+
+    AtomicSharedPtr<Payload> slot{MakeShared<Payload>()};
+
+    Ptr Load() {
+        return slot.Load();
+    }
+    void Store(Ptr ptr) {
+        slot.Store(std::move(ptr));
+    }
+    static Ptr Make() {
+        return MakeShared<Payload>();
+    }
+};
+
+struct MutexSlot {
+    using Ptr = SharedPtr<Payload>;
+
+    std::mutex mutex;
+    Ptr slot = MakeShared<Payload>();
+
+    Ptr Load() {
+        std::lock_guard lock(mutex);
+        return slot;
+    }
+    void Store(Ptr ptr) {
+        std::lock_guard lock(mutex);
+        slot.Swap(ptr);
+    }
+    static Ptr Make() {
+        return MakeShared<Payload>();
+    }
+};
+
+struct StdSlot {
+    using Ptr = std::shared_ptr<Payload>;
+
+    std::atomic<Ptr> slot{std::make_shared<Payload>()};
+
+    Ptr Load() {
+        return slot.load();
+    }
+    void Store(Ptr ptr) {
+        slot.store(std::move(ptr));
+    }
+    static Ptr Make() {
+        return std::make_shared<Payload>();
+    }
+};
+
+template <typename Slot>
+void AddSlotSuite(const std::string& group) {
+    // Shared by the threads of a run, and outlives all of them
+    static auto slot = new Slot();
+    bench::AddScaling(group, "load", [](bench::State& state) {
+        for (size_t i = 0; i < state.iterations; ++i) {
+            auto ptr = slot->Load();
+            bench::DoNotOptimize(ptr);
+        }
+    });
+    bench::AddScaling(group, "load_store/" + std::to_string(kStoreEvery),
+                      [](bench::State& state) {
+                          for (size_t i = 0; i < state.iterations; ++i) {
+                              if (state.thread == 0 && i % kStoreEvery == 0) {
+                                  slot->Store(Slot::Make());
+                              } else {
+                                  auto ptr = slot->Load();
+                                  bench::DoNotOptimize(ptr);
+                              }
+                          }
+                      });
+}
+
+const bool kRegistered = [] {
+    AddSlotSuite<LockFreeSlot>("AtomicSharedPtr");
+    AddSlotSuite<MutexSlot>("sft::SharedPtr<mutex>");
+    AddSlotSuite<StdSlot>("std::atomic<std::shared_ptr>");
+    return true;
+}();
+
+}  // namespace
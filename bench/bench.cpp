@@ -0,0 +1,301 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Counting allocator
+
+namespace {
+
+// Trivial, so it is usable before and after the thread's other thread-locals
+thread_local bench::AllocationCount thread_allocations;
+
+void* Allocate(size_t size, size_t alignment) {
+    ++thread_allocations.count;
+    thread_allocations.bytes += size;
+    if (size == 0) {
+        size = 1;
+    }
+    void* ptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        ptr = std::malloc(size);
+    } else {
+        ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+    return Allocate(size, alignof(std::max_align_t));
+}
+void* operator new[](size_t size) {
+    return Allocate(size, alignof(std::max_align_t));
+}
+void* operator new(size_t size, std::align_val_t alignment) {
+    return Allocate(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return Allocate(size, static_cast<size_t>(alignment));
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return Allocate(size, alignof(std::max_align_t));
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try {
+        return Allocate(size, static_cast<size_t>(alignment));
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return operator new(size, alignment, std::nothrow);
+}
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+namespace bench {
+
+AllocationCount GetThreadAllocations() {
+    return thread_allocations;
+}
+
+void State::PauseTiming() {
+    paused_at_ = std::chrono::steady_clock::now();
+    paused_at_allocations_ = GetThreadAllocations();
+}
+
+void State::ResumeTiming() {
+    AllocationCount now = GetThreadAllocations();
+    paused_allocations_.count += now.count - paused_at_allocations_.count;
+    paused_allocations_.bytes += now.bytes - paused_at_allocations_.bytes;
+    paused_ += std::chrono::steady_clock::now() - paused_at_;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Runner
+
+struct Benchmark {
+    std::string group;
+    std::string name;
+    Body body;
+    size_t threads;
+};
+
+struct Result {
+    size_t iterations = 0;
+    std::chrono::nanoseconds time{0};
+    AllocationCount allocations;
+};
+
+// Never destroyed: benchmarks register from static constructors of any translation unit
+static std::vector<Benchmark>& Benchmarks() {
+    static auto benchmarks = new std::vector<Benchmark>();
+    return *benchmarks;
+}
+
+void Add(std::string group, std::string name, Body body, size_t threads) {
+    Benchmarks().push_back({std::move(group), std::move(name), std::move(body), threads});
+}
+
+void AddScaling(std::string group, std::string name, Body body) {
+    size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t threads = 1;; threads = std::min(threads * 2, max_threads)) {
+        Add(group, name + "/threads:" + std::to_string(threads), body, threads);
+        if (threads == max_threads) {
+            break;
+        }
+    }
+}
+
+class Runner {
+public:
+    static Result RunOnce(const Benchmark& benchmark, size_t iterations) {
+        std::vector<State> states(benchmark.threads);
+        for (size_t i = 0; i < states.size(); ++i) {
+            states[i].iterations = iterations;
+            states[i].thread = i;
+            states[i].threads = states.size();
+        }
+        std::vector<AllocationCount> allocations(states.size());
+        std::atomic<size_t> ready = 0;
+        std::atomic<bool> go = false;
+        auto run = [&](size_t i) {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            AllocationCount before = GetThreadAllocations();
+            benchmark.body(states[i]);
+            AllocationCount after = GetThreadAllocations();
+            allocations[i].count = after.count - before.count - states[i].paused_allocations_.count;
+            allocations[i].bytes = after.bytes - before.bytes - states[i].paused_allocations_.bytes;
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < states.size(); ++i) {
+            workers.emplace_back(run, i);
+        }
+        while (ready.load() != states.size() - 1) {
+            std::this_thread::yield();
+        }
+        auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        run(0);
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        Result result;
+        result.iterations = iterations;
+        result.time = std::chrono::steady_clock::now() - start;
+        // Only the first thread may pause
+        result.time -= states[0].paused_;
+        for (const AllocationCount& count : allocations) {
+            result.allocations.count += count.count;
+            result.allocations.bytes += count.bytes;
+        }
+        return result;
+    }
+
+    // Grows the iteration count until a run takes at least `min_time`
+    static Result Run(const Benchmark& benchmark, std::chrono::nanoseconds min_time) {
+        size_t iterations = 1;
+        while (true) {
+            Result result = RunOnce(benchmark, iterations);
+            if (result.time >= min_time || iterations >= kMaxIterations) {
+                return result;
+            }
+            double factor = result.time.count() == 0
+                                ? 100.0
+                                : 1.4 * double(min_time.count()) / double(result.time.count());
+            factor = std::clamp(factor, 2.0, 100.0);
+            iterations = std::min(kMaxIterations, size_t(double(iterations) * factor));
+        }
+    }
+
+private:
+    static constexpr size_t kMaxIterations = size_t(1) << 30;
+};
+
+}  // namespace bench
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Driver
+
+using namespace bench;
+
+static void Usage(const char* program) {
+    std::printf(
+        "usage: %s [--json] [--list] [--filter=SUBSTRING] [--min-time=MS]\n"
+        "  --json       one JSON object per benchmark and line\n"
+        "  --filter     run only benchmarks whose group/name contains SUBSTRING\n"
+        "  --min-time   minimum duration of the measured run, 100 ms by default\n",
+        program);
+}
+
+int main(int argc, char** argv) {
+    bool json = false;
+    bool list = false;
+    std::string filter;
+    std::chrono::nanoseconds min_time = std::chrono::milliseconds(100);
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (std::strcmp(argv[i], "--list") == 0) {
+            list = true;
+        } else if (std::strncmp(argv[i], "--filter=", 9) == 0) {
+            filter = argv[i] + 9;
+        } else if (std::strncmp(argv[i], "--min-time=", 11) == 0) {
+            min_time = std::chrono::milliseconds(std::atol(argv[i] + 11));
+        } else {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Benchmark>& benchmarks = Benchmarks();
+    std::stable_sort(benchmarks.begin(), benchmarks.end(),
+                     [](const Benchmark& a, const Benchmark& b) { return a.group < b.group; });
+    if (!json && !list) {
+        std::printf("%-48s %8s %12s %10s %10s\n", "benchmark", "threads", "ns/op", "allocs/op",
+                    "bytes/op");
+    }
+    for (const Benchmark& benchmark : benchmarks) {
+        std::string full_name = benchmark.group + "/" + benchmark.name;
+        if (full_name.find(filter) == std::string::npos) {
+            continue;
+        }
+        if (list) {
+            std::printf("%s\n", full_name.c_str());
+            continue;
+        }
+        Result result = Runner::Run(benchmark, min_time);
+        double ns = double(result.time.count()) / double(result.iterations);
+        double ops = double(result.iterations) * double(benchmark.threads);
+        double allocs = double(result.allocations.count) / ops;
+        double bytes = double(result.allocations.bytes) / ops;
+        if (json) {
+            std::printf(
+                "{\"group\":\"%s\",\"name\":\"%s\",\"threads\":%zu,\"iterations\":%zu,"
+                "\"ns_per_op\":%.3f,\"allocs_per_op\":%.4f,\"bytes_per_op\":%.2f}\n",
+                benchmark.group.c_str(), benchmark.name.c_str(), benchmark.threads,
+                result.iterations, ns, allocs, bytes);
+        } else {
+            std::printf("%-48s %8zu %12.2f %10.3f %10.1f\n", full_name.c_str(), benchmark.threads,
+                        ns, allocs, bytes);
+        }
+        std::fflush(stdout);
+    }
+    return 0;
+}
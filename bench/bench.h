@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Self-contained microbenchmark harness: no downloads, only `std::chrono` and a counting global
+// `operator new`. Each benchmark reports ns/op, allocations/op and allocated bytes/op, as a
+// table or, with `--json`, as one JSON object per line for regression gates.
+//
+// A body runs `state.iterations` operations. Timing may be paused around per-batch setup with
+// `PauseTiming` / `ResumeTiming`; multi-threaded benchmarks run one body per thread, started
+// together, and report wall time per operation of a single thread.
+
+namespace bench {
+
+struct AllocationCount {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+// Allocations made so far by the calling thread
+AllocationCount GetThreadAllocations();
+
+class State {
+public:
+    size_t iterations;
+    // Index of the calling thread, below `threads`
+    size_t thread;
+    size_t threads;
+
+    void PauseTiming();
+    void ResumeTiming();
+
+private:
+    friend class Runner;
+
+    std::chrono::steady_clock::time_point paused_at_;
+    std::chrono::nanoseconds paused_{0};
+    AllocationCount paused_allocations_;
+    AllocationCount paused_at_allocations_;
+};
+
+using Body = std::function<void(State& state)>;
+
+// Registers a benchmark; `threads` copies of the body run concurrently
+void Add(std::string group, std::string name, Body body, size_t threads = 1);
+
+// Registers `name/threads:N` for N = 1, 2, 4, ... up to the hardware concurrency
+void AddScaling(std::string group, std::string name, Body body);
+
+// Registers at static initialization time
+struct Register {
+    Register(std::string group, std::string name, Body body, size_t threads = 1) {
+        Add(std::move(group), std::move(name), std::move(body), threads);
+    }
+};
+
+// Keeps the compiler from dropping a value or the stores behind it
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+inline void ClobberMemory() {
+    asm volatile("" : : : "memory");
+}
+
+}  // namespace bench
@@ -0,0 +1,63 @@
+#include "suite.h"
+
+#include "shared-from-this/shared.h"
+
+#include <optional>
+
+// Releases under a `DeferredDecrementScope` against eager decrements, for a destroy-heavy load
+// (dropping many copies of a few objects) and a copy-heavy one (copying and dropping in place).
+// The deferred runs include the flushes, the last one when the scope ends.
+
+namespace {
+
+using bench::Payload;
+using Ptr = SharedPtr<Payload>;
+
+// Distinct objects among the copies of the destroy-heavy load
+constexpr size_t kObjects = 8;
+
+template <bool kDeferred>
+void AddDeferredSuite(const std::string& group) {
+    bench::Add(group, "drop_copies", [](bench::State& state) {
+        std::optional<DeferredDecrementScope> scope;
+        if constexpr (kDeferred) {
+            scope.emplace();
+        }
+        std::vector<Ptr> objects;
+        for (size_t i = 0; i < kObjects; ++i) {
+            objects.push_back(MakeShared<Payload>());
+        }
+        std::vector<Ptr> copies;
+        copies.reserve(bench::kBatch);
+        bench::Batched(
+            state,
+            [&](size_t count) {
+                for (size_t i = 0; i < count; ++i) {
+                    copies.push_back(objects[i % kObjects]);
+                }
+            },
+            [&](size_t) {
+                copies.clear();
+                bench::ClobberMemory();
+            });
+    });
+    bench::Add(group, "copy_drop", [](bench::State& state) {
+        std::optional<DeferredDecrementScope> scope;
+        if constexpr (kDeferred) {
+            scope.emplace();
+        }
+        Ptr ptr = MakeShared<Payload>();
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr copy(ptr);
+            bench::DoNotOptimize(copy);
+        }
+    });
+}
+
+const bool kRegistered = [] {
+    AddDeferredSuite<true>("sft::SharedPtr<deferred>");
+    AddDeferredSuite<false>("sft::SharedPtr");
+    return true;
+}();
+
+}  // namespace
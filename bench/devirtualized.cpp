@@ -0,0 +1,227 @@
+#include "suite.h"
+
+#include "shared-from-this/weak.h"
+
+#include <atomic>
+#include <new>
+#include <utility>
+
+// The counting hot path of `SharedPtr` against the control block it replaced, whose counters
+// were reached through virtual calls on every copy, destruction, `UseCount` and `Lock`.
+
+namespace {
+
+using bench::Payload;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Virtual control block
+
+class VirtualBlock {
+public:
+    virtual void IncStrong() = 0;
+    virtual void DecStrong() = 0;
+    virtual int GetStrongCount() = 0;
+    virtual void IncWeak() = 0;
+    virtual void DecWeak() = 0;
+    virtual ~VirtualBlock() = default;
+
+protected:
+    std::atomic<int> strong_counter_ = 1;
+    std::atomic<int> weak_counter_ = 1;
+};
+
+template <typename T>
+class VirtualBlockObj : public VirtualBlock {
+public:
+    VirtualBlockObj() {
+        new (&storage_) T();
+    }
+
+    T* Get() {
+        return std::launder(reinterpret_cast<T*>(&storage_));
+    }
+
+    void IncStrong() override {
+        strong_counter_.fetch_add(1, std::memory_order_relaxed);
+    }
+    void DecStrong() override {
+        if (strong_counter_.fetch_sub(1, std::memory_order_release) == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            Get()->~T();
+            DecWeak();
+        }
+    }
+    int GetStrongCount() override {
+        return strong_counter_.load(std::memory_order_relaxed);
+    }
+    void IncWeak() override {
+        weak_counter_.fetch_add(1, std::memory_order_relaxed);
+    }
+    void DecWeak() override {
+        if (weak_counter_.fetch_sub(1, std::memory_order_release) == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            delete this;
+        }
+    }
+
+private:
+    alignas(T) unsigned char storage_[sizeof(T)];
+};
+
+// Out of line, so the compiler cannot see the dynamic type at the call sites
+template <typename T>
+[[gnu::noinline]] VirtualBlock* NewVirtualBlock(T*& object) {
+    auto block = new VirtualBlockObj<T>();
+    object = block->Get();
+    return block;
+}
+
+template <typename T>
+class VirtualWeak;
+
+template <typename T>
+class VirtualShared {
+public:
+    VirtualShared() = default;
+    VirtualShared(const VirtualShared& other) : block_(other.block_), ptr_(other.ptr_) {
+        if (block_ != nullptr) {
+            block_->IncStrong();
+        }
+    }
+    VirtualShared(VirtualShared&& other) noexcept
+        : block_(std::exchange(other.block_, nullptr)), ptr_(std::exchange(other.ptr_, nullptr)) {
+    }
+    VirtualShared& operator=(VirtualShared other) noexcept {
+        std::swap(block_, other.block_);
+        std::swap(ptr_, other.ptr_);
+        return *this;
+    }
+    ~VirtualShared() {
+        if (block_ != nullptr) {
+            block_->DecStrong();
+        }
+    }
+
+    static VirtualShared Make() {
+        VirtualShared result;
+        result.block_ = NewVirtualBlock(result.ptr_);
+        return result;
+    }
+
+    size_t UseCount() const {
+        return block_ == nullptr ? 0 : block_->GetStrongCount();
+    }
+
+private:
+    friend class VirtualWeak<T>;
+
+    VirtualBlock* block_ = nullptr;
+    T* ptr_ = nullptr;
+};
+
+template <typename T>
+class VirtualWeak {
+public:
+    explicit VirtualWeak(const VirtualShared<T>& shared)
+        : block_(shared.block_), ptr_(shared.ptr_) {
+        block_->IncWeak();
+    }
+    VirtualWeak(const VirtualWeak&) = delete;
+    ~VirtualWeak() {
+        block_->DecWeak();
+    }
+
+    // As `Lock` was: `Expired()`, then an unconditional increment
+    VirtualShared<T> Lock() const {
+        VirtualShared<T> result;
+        if (block_->GetStrongCount() != 0) {
+            block_->IncStrong();
+            result.block_ = block_;
+            result.ptr_ = ptr_;
+        }
+        return result;
+    }
+
+private:
+    VirtualBlock* block_;
+    T* ptr_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Families
+
+struct VirtualFamily {
+    using Ptr = VirtualShared<Payload>;
+    using Weak = VirtualWeak<Payload>;
+
+    static Ptr Make() {
+        return Ptr::Make();
+    }
+    static size_t UseCount(const Ptr& ptr) {
+        return ptr.UseCount();
+    }
+    static Ptr Lock(const Weak& weak) {
+        return weak.Lock();
+    }
+};
+
+struct Family {
+    using Ptr = SharedPtr<Payload>;
+    using Weak = WeakPtr<Payload>;
+
+    static Ptr Make() {
+        return MakeShared<Payload>();
+    }
+    static size_t UseCount(const Ptr& ptr) {
+        return ptr.UseCount();
+    }
+    static Ptr Lock(const Weak& weak) {
+        return weak.Lock();
+    }
+};
+
+template <typename Family>
+void AddHotPathSuite(const std::string& group) {
+    using Ptr = typename Family::Ptr;
+    using Weak = typename Family::Weak;
+
+    bench::Add(group, "hot/copy", [](bench::State& state) {
+        Ptr ptr = Family::Make();
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr copy(ptr);
+            bench::DoNotOptimize(copy);
+        }
+    });
+    bench::Add(group, "hot/move", [](bench::State& state) {
+        Ptr a = Family::Make();
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr b(std::move(a));
+            bench::DoNotOptimize(b);
+            a = std::move(b);
+        }
+    });
+    bench::Add(group, "hot/use_count", [](bench::State& state) {
+        Ptr ptr = Family::Make();
+        for (size_t i = 0; i < state.iterations; ++i) {
+            size_t count = Family::UseCount(ptr);
+            bench::DoNotOptimize(count);
+            bench::DoNotOptimize(ptr);
+        }
+    });
+    bench::Add(group, "hot/lock", [](bench::State& state) {
+        Ptr ptr = Family::Make();
+        Weak weak(ptr);
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr locked = Family::Lock(weak);
+            bench::DoNotOptimize(locked);
+        }
+    });
+}
+
+const bool kRegistered = [] {
+    AddHotPathSuite<Family>("sft::SharedPtr");
+    AddHotPathSuite<VirtualFamily>("sft::SharedPtr<virtual block>");
+    return true;
+}();
+
+}  // namespace
@@ -0,0 +1,43 @@
+#include "suite.h"
+
+#include "intrusive/intrusive.h"
+#include "shared-from-this/shared.h"
+
+#include <memory>
+
+// Bytes allocated per object, read off the bytes/op column: a 4-byte payload owned by
+// `std::shared_ptr`, by `SharedPtr` and by `IntrusivePtr` with 16-, 32- and 64-bit counters.
+
+namespace {
+
+struct Value {
+    int32_t value = 0;
+};
+
+template <typename Int>
+struct Counted : SizedRefCounted<Counted<Int>, Int> {
+    int32_t value = 0;
+};
+
+template <typename Make>
+void AddFootprint(const std::string& name, Make make) {
+    bench::Add("footprint", name, [make](bench::State& state) {
+        for (size_t i = 0; i < state.iterations; ++i) {
+            auto ptr = make();
+            bench::DoNotOptimize(ptr);
+        }
+    });
+}
+
+const bool kRegistered = [] {
+    AddFootprint("std::make_shared", [] { return std::make_shared<Value>(); });
+    AddFootprint("std::shared_ptr(new)", [] { return std::shared_ptr<Value>(new Value()); });
+    AddFootprint("sft::MakeShared", [] { return MakeShared<Value>(); });
+    AddFootprint("sft::SharedPtr(new)", [] { return SharedPtr<Value>(new Value()); });
+    AddFootprint("IntrusivePtr<uint16_t>", [] { return MakeIntrusive<Counted<uint16_t>>(); });
+    AddFootprint("IntrusivePtr<uint32_t>", [] { return MakeIntrusive<Counted<uint32_t>>(); });
+    AddFootprint("IntrusivePtr<uint64_t>", [] { return MakeIntrusive<Counted<uint64_t>>(); });
+    return true;
+}();
+
+}  // namespace
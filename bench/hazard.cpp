@@ -0,0 +1,79 @@
+#include "suite.h"
+
+#include "intrusive/hazard.h"
+
+#include <atomic>
+
+// Walking a shared linked list while holding each node with a hazard pointer, against copying
+// an `IntrusivePtr` to every node on the way; one operation is one hop.
+
+namespace {
+
+constexpr size_t kListLength = 64;
+
+struct HazardNode : HazardRefCounted<HazardNode> {
+    std::atomic<HazardNode*> next = nullptr;
+    int64_t value = 0;
+};
+
+struct CountedNode : ThreadSafeRefCounted<CountedNode> {
+    IntrusivePtr<CountedNode> next;
+    int64_t value = 0;
+};
+
+// Built before any thread starts and never freed, so the walks need no writer
+std::atomic<HazardNode*>& HazardList() {
+    static auto head = [] {
+        auto list = new std::atomic<HazardNode*>(nullptr);
+        for (size_t i = 0; i < kListLength; ++i) {
+            HazardNode* node = MakeIntrusive<HazardNode>().Detach();
+            node->next.store(list->load());
+            list->store(node);
+        }
+        return list;
+    }();
+    return *head;
+}
+
+const IntrusivePtr<CountedNode>& CountedList() {
+    static auto head = [] {
+        auto list = new IntrusivePtr<CountedNode>();
+        for (size_t i = 0; i < kListLength; ++i) {
+            auto node = MakeIntrusive<CountedNode>();
+            node->next = std::move(*list);
+            *list = std::move(node);
+        }
+        return list;
+    }();
+    return *head;
+}
+
+const bool kRegistered = [] {
+    HazardList();
+    CountedList();
+    bench::AddScaling("HazardPointer", "traverse", [](bench::State& state) {
+        // Hand over hand: the current node stays protected while the next one is
+        HazardPointer hazards[2];
+        size_t current = 0;
+        HazardNode* node = nullptr;
+        for (size_t i = 0; i < state.iterations; ++i) {
+            const std::atomic<HazardNode*>& source = node == nullptr ? HazardList() : node->next;
+            node = hazards[current ^= 1].Protect(source);
+            if (node != nullptr) {
+                bench::DoNotOptimize(node->value);
+            }
+        }
+    });
+    bench::AddScaling("IntrusivePtr<ThreadSafe>", "traverse", [](bench::State& state) {
+        IntrusivePtr<CountedNode> node;
+        for (size_t i = 0; i < state.iterations; ++i) {
+            node = node ? node->next : CountedList();
+            if (node) {
+                bench::DoNotOptimize(node->value);
+            }
+        }
+    });
+    return true;
+}();
+
+}  // namespace
@@ -0,0 +1,38 @@
+#include "suite.h"
+
+#include "intrusive/intrusive.h"
+
+namespace {
+
+struct Object : SimpleRefCounted<Object> {
+    int64_t value = 0;
+};
+
+struct ThreadSafeObject : ThreadSafeRefCounted<ThreadSafeObject> {
+    int64_t value = 0;
+};
+
+// Constructs `Payload` as `T`: the counter lives in the object
+template <typename T>
+struct Family {
+    template <typename>
+    using Ptr = IntrusivePtr<T>;
+
+    template <typename>
+    static Ptr<T> New() {
+        return Ptr<T>(new T());
+    }
+    template <typename>
+    static Ptr<T> Make() {
+        return MakeIntrusive<T>();
+    }
+};
+
+const bool kRegistered = [] {
+    bench::AddSharedSuite<Family<Object>>("IntrusivePtr");
+    bench::AddSharedSuite<Family<ThreadSafeObject>>("IntrusivePtr<ThreadSafe>");
+    bench::AddContentionSuite<Family<ThreadSafeObject>>("IntrusivePtr<ThreadSafe>");
+    return true;
+}();
+
+}  // namespace
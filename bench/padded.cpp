@@ -0,0 +1,41 @@
+#include "suite.h"
+
+#include "shared-from-this/shared.h"
+
+// Readers of an object's fields next to threads copying pointers to it: with `MakeShared` the
+// copies write the counters on the object's cache line, with `MakeSharedPadded` they do not.
+// Even threads read, odd threads copy.
+
+namespace {
+
+using bench::Payload;
+
+template <typename Make>
+void AddReadWhileCopied(const std::string& group, Make make) {
+    // Shared by the threads of a run, and outlives all of them
+    static auto shared = new SharedPtr<Payload>(make());
+    auto body = [](bench::State& state) {
+        if (state.thread % 2 == 0) {
+            const Payload* object = shared->Get();
+            for (size_t i = 0; i < state.iterations; ++i) {
+                bench::DoNotOptimize(object->value);
+                bench::ClobberMemory();
+            }
+        } else {
+            for (size_t i = 0; i < state.iterations; ++i) {
+                SharedPtr<Payload> copy(*shared);
+                bench::DoNotOptimize(copy);
+            }
+        }
+    };
+    bench::Add(group, "read_while_copied/threads:2", body, 2);
+    bench::Add(group, "read_while_copied/threads:4", body, 4);
+}
+
+const bool kRegistered = [] {
+    AddReadWhileCopied("sft::SharedPtr", [] { return MakeShared<Payload>(); });
+    AddReadWhileCopied("sft::SharedPtr<padded>", [] { return MakeSharedPadded<Payload>(); });
+    return true;
+}();
+
+}  // namespace
@@ -0,0 +1,83 @@
+#include "suite.h"
+
+#include "shared-from-this/shared.h"
+#include "unique/relocate.h"
+
+#include <unordered_map>
+
+// Growing containers of `SharedPtr`: `RelocatingVector` and `RelocatingHashMap` move their
+// elements with `memcpy`; the wrappers below opt out, element by element (`Pinned`) or, with a
+// move that may throw, into the copies `std::vector` falls back to (`ThrowingMove`). The
+// relocating containers take their storage from `malloc`, which the allocation columns miss.
+
+namespace {
+
+using bench::Payload;
+using Ptr = SharedPtr<Payload>;
+
+struct Pinned {
+    Ptr ptr;
+};
+
+struct ThrowingMove {
+    Ptr ptr;
+
+    explicit ThrowingMove(const Ptr& ptr) : ptr(ptr) {
+    }
+    ThrowingMove(const ThrowingMove&) = default;
+    ThrowingMove(ThrowingMove&& other) noexcept(false) : ptr(std::move(other.ptr)) {
+    }
+};
+
+static_assert(kIsTriviallyRelocatable<Ptr> && !kIsTriviallyRelocatable<Pinned>);
+static_assert(!std::is_nothrow_move_constructible_v<ThrowingMove>);
+
+const std::string kSize = "/" + std::to_string(bench::kVectorSize);
+
+template <typename Vector, typename Element>
+void AddPushBack(const std::string& group, const std::string& name) {
+    bench::Add(group, "push_back/" + name + kSize, [](bench::State& state) {
+        Ptr ptr = MakeShared<Payload>();
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Vector vector;
+            for (size_t j = 0; j < bench::kVectorSize; ++j) {
+                if constexpr (std::is_same_v<Vector, std::vector<Element>>) {
+                    vector.push_back(Element{ptr});
+                } else {
+                    vector.PushBack(Element{ptr});
+                }
+            }
+            bench::DoNotOptimize(vector);
+        }
+    });
+}
+
+template <typename Map>
+void AddEmplace(const std::string& group) {
+    bench::Add(group, "emplace" + kSize, [](bench::State& state) {
+        Ptr ptr = MakeShared<Payload>();
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Map map;
+            for (size_t key = 0; key < bench::kVectorSize; ++key) {
+                if constexpr (std::is_same_v<Map, std::unordered_map<size_t, Ptr>>) {
+                    map.emplace(key, ptr);
+                } else {
+                    map.Emplace(key, ptr);
+                }
+            }
+            bench::DoNotOptimize(map);
+        }
+    });
+}
+
+const bool kRegistered = [] {
+    AddPushBack<RelocatingVector<Ptr>, Ptr>("RelocatingVector", "sft::SharedPtr");
+    AddPushBack<RelocatingVector<Pinned>, Pinned>("RelocatingVector", "Pinned");
+    AddPushBack<std::vector<Ptr>, Ptr>("std::vector", "sft::SharedPtr");
+    AddPushBack<std::vector<ThrowingMove>, ThrowingMove>("std::vector", "ThrowingMove");
+    AddEmplace<RelocatingHashMap<size_t, Ptr>>("RelocatingHashMap");
+    AddEmplace<std::unordered_map<size_t, Ptr>>("std::unordered_map");
+    return true;
+}();
+
+}  // namespace
@@ -0,0 +1,26 @@
+#include "suite.h"
+
+#include "shared/shared.h"
+
+namespace {
+
+struct Family {
+    template <typename T>
+    using Ptr = SharedPtr<T>;
+
+    template <typename T>
+    static Ptr<T> New() {
+        return Ptr<T>(new T());
+    }
+    template <typename T>
+    static Ptr<T> Make() {
+        return MakeShared<T>();
+    }
+};
+
+const bool kRegistered = [] {
+    bench::AddSharedSuite<Family>("shared::SharedPtr");
+    return true;
+}();
+
+}  // namespace
@@ -0,0 +1,61 @@
+#include "suite.h"
+
+#include "shared-from-this/weak.h"
+
+#include <memory>
+
+namespace {
+
+struct Family {
+    template <typename T>
+    using Ptr = SharedPtr<T>;
+    template <typename T>
+    using Weak = WeakPtr<T>;
+
+    template <typename T>
+    static Ptr<T> New() {
+        return Ptr<T>(new T());
+    }
+    template <typename T>
+    static Ptr<T> Make() {
+        return MakeShared<T>();
+    }
+    template <typename T>
+    static Ptr<T> Lock(const Weak<T>& weak) {
+        return weak.Lock();
+    }
+};
+
+struct Node : EnableSharedFromThis<Node> {
+    int64_t value = 0;
+};
+
+struct StdNode : std::enable_shared_from_this<StdNode> {
+    int64_t value = 0;
+};
+
+const bool kRegistered = [] {
+    bench::AddSharedSuite<Family>("sft::SharedPtr");
+    bench::AddWeakSuite<Family>("sft::SharedPtr");
+    bench::AddContentionSuite<Family>("sft::SharedPtr");
+    return true;
+}();
+
+bench::Register shared_from_this("sft::SharedPtr", "shared_from_this", [](bench::State& state) {
+    SharedPtr<Node> node = MakeShared<Node>();
+    for (size_t i = 0; i < state.iterations; ++i) {
+        SharedPtr<Node> self = node->SharedFromThis();
+        bench::DoNotOptimize(self);
+    }
+});
+
+bench::Register std_shared_from_this("std::shared_ptr", "shared_from_this",
+                                     [](bench::State& state) {
+                                         auto node = std::make_shared<StdNode>();
+                                         for (size_t i = 0; i < state.iterations; ++i) {
+                                             auto self = node->shared_from_this();
+                                             bench::DoNotOptimize(self);
+                                         }
+                                     });
+
+}  // namespace
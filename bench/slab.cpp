@@ -0,0 +1,60 @@
+#include "suite.h"
+
+#include "shared-from-this/shared.h"
+
+// Control block churn through the slab allocator and through `operator new`, for a few object
+// sizes: `Sized<N, true>` opts into the slab, `Sized<N, false>` keeps the build's default.
+
+namespace {
+
+template <size_t N, bool Slab>
+struct Sized {
+    unsigned char bytes[N] = {};
+};
+
+}  // namespace
+
+template <size_t N>
+struct UseSlabControlBlock<Sized<N, true>> : std::true_type {};
+
+namespace {
+
+template <size_t N, bool Slab>
+void AddChurn(const std::string& group) {
+    using Ptr = SharedPtr<Sized<N, Slab>>;
+
+    std::string bytes = "/bytes:" + std::to_string(N);
+    bench::AddScaling(group, "make" + bytes, [](bench::State& state) {
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr ptr = MakeShared<Sized<N, Slab>>();
+            bench::DoNotOptimize(ptr);
+        }
+    });
+    bench::AddScaling(group, "make_batch" + bytes, [](bench::State& state) {
+        std::vector<Ptr> ptrs;
+        ptrs.reserve(bench::kBatch);
+        for (size_t done = 0; done < state.iterations; done += bench::kBatch) {
+            size_t count = std::min(bench::kBatch, state.iterations - done);
+            for (size_t i = 0; i < count; ++i) {
+                ptrs.push_back(MakeShared<Sized<N, Slab>>());
+            }
+            ptrs.clear();
+            bench::ClobberMemory();
+        }
+    });
+}
+
+template <bool Slab>
+void AddChurnSuite(const std::string& group) {
+    AddChurn<8, Slab>(group);
+    AddChurn<64, Slab>(group);
+    AddChurn<256, Slab>(group);
+}
+
+const bool kRegistered = [] {
+    AddChurnSuite<true>("sft::SharedPtr<slab>");
+    AddChurnSuite<false>("sft::SharedPtr");
+    return true;
+}();
+
+}  // namespace
@@ -0,0 +1,13 @@
+#include "suite.h"
+
+namespace {
+
+const bool kRegistered = [] {
+    bench::AddSharedSuite<bench::StdShared>("std::shared_ptr");
+    bench::AddWeakSuite<bench::StdShared>("std::shared_ptr");
+    bench::AddContentionSuite<bench::StdShared>("std::shared_ptr");
+    bench::AddUniqueSuite<bench::StdUnique>("std::unique_ptr");
+    return true;
+}();
+
+}  // namespace
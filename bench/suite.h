@@ -0,0 +1,252 @@
+#pragma once
+
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The operations every pointer family is measured on, each against its `std::` counterpart.
+// A family is a struct naming its pointer template and factories, as `StdShared` does.
+
+namespace bench {
+
+struct Payload {
+    int64_t value = 0;
+};
+
+// Objects built and dropped per timed batch of the destroy benchmarks
+inline constexpr size_t kBatch = 1024;
+inline constexpr size_t kVectorSize = 1000;
+
+struct StdShared {
+    template <typename T>
+    using Ptr = std::shared_ptr<T>;
+    template <typename T>
+    using Weak = std::weak_ptr<T>;
+
+    template <typename T>
+    static Ptr<T> New() {
+        return Ptr<T>(new T());
+    }
+    template <typename T>
+    static Ptr<T> Make() {
+        return std::make_shared<T>();
+    }
+    template <typename T>
+    static Ptr<T> Lock(const Weak<T>& weak) {
+        return weak.lock();
+    }
+};
+
+struct StdUnique {
+    template <typename T>
+    using Ptr = std::unique_ptr<T>;
+
+    template <typename T>
+    static Ptr<T> New() {
+        return Ptr<T>(new T());
+    }
+    template <typename T>
+    static Ptr<T> Make() {
+        return std::make_unique<T>();
+    }
+    template <typename T>
+    static void Reset(Ptr<T>& ptr) {
+        ptr.reset(new T());
+    }
+};
+
+// Runs `body` over the iterations in batches of `kBatch`, with `setup` untimed before each
+template <typename Setup, typename Body>
+void Batched(State& state, Setup&& setup, Body&& body) {
+    for (size_t done = 0; done < state.iterations; done += kBatch) {
+        size_t count = std::min(kBatch, state.iterations - done);
+        state.PauseTiming();
+        setup(count);
+        state.ResumeTiming();
+        body(count);
+    }
+}
+
+// Construction, copy, move, destroy and containers, for owners counted like `std::shared_ptr`
+template <typename Family>
+void AddSharedSuite(const std::string& group) {
+    using Ptr = typename Family::template Ptr<Payload>;
+
+    Add(group, "new", [](State& state) {
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr ptr = Family::template New<Payload>();
+            DoNotOptimize(ptr);
+        }
+    });
+    Add(group, "make", [](State& state) {
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr ptr = Family::template Make<Payload>();
+            DoNotOptimize(ptr);
+        }
+    });
+    Add(group, "copy", [](State& state) {
+        Ptr ptr = Family::template Make<Payload>();
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr copy(ptr);
+            DoNotOptimize(copy);
+        }
+    });
+    Add(group, "move", [](State& state) {
+        Ptr a = Family::template Make<Payload>();
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr b(std::move(a));
+            DoNotOptimize(b);
+            a = std::move(b);
+        }
+    });
+    Add(group, "destroy", [](State& state) {
+        std::vector<Ptr> ptrs;
+        ptrs.reserve(kBatch);
+        Batched(
+            state,
+            [&](size_t count) {
+                for (size_t i = 0; i < count; ++i) {
+                    ptrs.push_back(Family::template Make<Payload>());
+                }
+            },
+            [&](size_t) {
+                ptrs.clear();
+                ClobberMemory();
+            });
+    });
+    Add(group, "vector_copy/" + std::to_string(kVectorSize), [](State& state) {
+        Ptr ptr = Family::template Make<Payload>();
+        std::vector<Ptr> ptrs(kVectorSize, ptr);
+        for (size_t i = 0; i < state.iterations; ++i) {
+            std::vector<Ptr> copy(ptrs);
+            DoNotOptimize(copy);
+        }
+    });
+}
+
+// Copies of one object shared by all threads, of one object per thread, and construction and
+// destruction on every thread: where the counter's cache line and the allocator contend
+template <typename Family>
+void AddContentionSuite(const std::string& group) {
+    using Ptr = typename Family::template Ptr<Payload>;
+
+    // Built before any thread starts, and never destroyed while one runs
+    static Ptr shared = Family::template Make<Payload>();
+    AddScaling(group, "copy_shared", [](State& state) {
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr copy(shared);
+            DoNotOptimize(copy);
+        }
+    });
+    AddScaling(group, "copy_private", [](State& state) {
+        Ptr ptr = Family::template Make<Payload>();
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr copy(ptr);
+            DoNotOptimize(copy);
+        }
+    });
+    AddScaling(group, "make_destroy", [](State& state) {
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr ptr = Family::template Make<Payload>();
+            DoNotOptimize(ptr);
+        }
+    });
+}
+
+// `Lock` of a live and of an expired object, and of one object from every thread, for families
+// with weak pointers
+template <typename Family>
+void AddWeakSuite(const std::string& group) {
+    using Ptr = typename Family::template Ptr<Payload>;
+    using Weak = typename Family::template Weak<Payload>;
+
+    Add(group, "lock", [](State& state) {
+        Ptr ptr = Family::template Make<Payload>();
+        Weak weak(ptr);
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr locked = Family::Lock(weak);
+            DoNotOptimize(locked);
+        }
+    });
+    Add(group, "lock_expired", [](State& state) {
+        Weak weak(Family::template Make<Payload>());
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr locked = Family::Lock(weak);
+            DoNotOptimize(locked);
+        }
+    });
+    // Every thread locks the same object, so the increment-if-nonzero races
+    static Ptr shared = Family::template Make<Payload>();
+    AddScaling(group, "lock_shared", [](State& state) {
+        Weak weak(shared);
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr locked = Family::Lock(weak);
+            DoNotOptimize(locked);
+        }
+    });
+}
+
+// Construction, move, `Reset`, destroy and containers, for single owners
+template <typename Family>
+void AddUniqueSuite(const std::string& group) {
+    using Ptr = typename Family::template Ptr<Payload>;
+
+    Add(group, "new", [](State& state) {
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr ptr = Family::template New<Payload>();
+            DoNotOptimize(ptr);
+        }
+    });
+    Add(group, "make", [](State& state) {
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr ptr = Family::template Make<Payload>();
+            DoNotOptimize(ptr);
+        }
+    });
+    Add(group, "move", [](State& state) {
+        Ptr a = Family::template Make<Payload>();
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Ptr b(std::move(a));
+            DoNotOptimize(b);
+            a = std::move(b);
+        }
+    });
+    Add(group, "reset", [](State& state) {
+        Ptr ptr = Family::template Make<Payload>();
+        for (size_t i = 0; i < state.iterations; ++i) {
+            Family::Reset(ptr);
+            DoNotOptimize(ptr);
+        }
+    });
+    Add(group, "destroy", [](State& state) {
+        std::vector<Ptr> ptrs;
+        ptrs.reserve(kBatch);
+        Batched(
+            state,
+            [&](size_t count) {
+                for (size_t i = 0; i < count; ++i) {
+                    ptrs.push_back(Family::template Make<Payload>());
+                }
+            },
+            [&](size_t) {
+                ptrs.clear();
+                ClobberMemory();
+            });
+    });
+    Add(group, "vector_push/" + std::to_string(kVectorSize), [](State& state) {
+        for (size_t i = 0; i < state.iterations; ++i) {
+            std::vector<Ptr> ptrs;
+            for (size_t j = 0; j < kVectorSize; ++j) {
+                ptrs.push_back(Family::template Make<Payload>());
+            }
+            DoNotOptimize(ptrs);
+        }
+    });
+}
+
+}  // namespace bench
@@ -0,0 +1,51 @@
+#include "suite.h"
+
+#include "unique/pool.h"
+#include "unique/unique.h"
+
+namespace {
+
+struct Family {
+    template <typename T>
+    using Ptr = UniquePtr<T>;
+
+    template <typename T>
+    static Ptr<T> New() {
+        return Ptr<T>(new T());
+    }
+    template <typename T>
+    static Ptr<T> Make() {
+        return MakeUnique<T>();
+    }
+    template <typename T>
+    static void Reset(Ptr<T>& ptr) {
+        ptr.Reset(new T());
+    }
+};
+
+// Objects recycled through the calling thread's `ObjectPool`
+struct PoolFamily {
+    template <typename T>
+    using Ptr = UniquePtr<T, PoolDeleter<T>>;
+
+    template <typename T>
+    static Ptr<T> New() {
+        return MakeUniqueFromPool<T>(LocalObjectPool<T>());
+    }
+    template <typename T>
+    static Ptr<T> Make() {
+        return MakeUniqueFromPool<T>(LocalObjectPool<T>());
+    }
+    template <typename T>
+    static void Reset(Ptr<T>& ptr) {
+        ptr = MakeUniqueFromPool<T>(LocalObjectPool<T>());
+    }
+};
+
+const bool kRegistered = [] {
+    bench::AddUniqueSuite<Family>("UniquePtr");
+    bench::AddUniqueSuite<PoolFamily>("UniquePtr<PoolDeleter>");
+    return true;
+}();
+
+}  // namespace
@@ -0,0 +1,34 @@
+#include "suite.h"
+
+#include "weak/weak.h"
+
+namespace {
+
+struct Family {
+    template <typename T>
+    using Ptr = SharedPtr<T>;
+    template <typename T>
+    using Weak = WeakPtr<T>;
+
+    template <typename T>
+    static Ptr<T> New() {
+        return Ptr<T>(new T());
+    }
+    template <typename T>
+    static Ptr<T> Make() {
+        return MakeShared<T>();
+    }
+    template <typename T>
+    static Ptr<T> Lock(const Weak<T>& weak) {
+        return weak.Lock();
+    }
+};
+
+const bool kRegistered = [] {
+    bench::AddSharedSuite<Family>("weak::SharedPtr");
+    bench::AddWeakSuite<Family>("weak::SharedPtr");
+    bench::AddContentionSuite<Family>("weak::SharedPtr");
+    return true;
+}();
+
+}  // namespace
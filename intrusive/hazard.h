@@ -0,0 +1,237 @@
+#pragma once
+
+#include "intrusive/intrusive.h"
+#include "unique/lifetime.h"
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+
+// Hazard-pointer reclamation domain, cf. Michael, "Hazard Pointers" (2004) / folly::hazptr.
+//
+// Readers of a lock-free structure publish the raw pointer they are about to dereference in a
+// `HazardPointer` instead of taking a reference. Objects counted with `RetireDelete` are not
+// destroyed when their count drops to zero but handed to the domain, which frees them once no
+// hazard pointer names them anymore. Objects are retired onto a lock-free list through a node
+// they carry, so retiring never allocates; every `scan_threshold` retirements one thread scans
+// the hazards and frees what is unprotected.
+
+// The link a `HazardDomain` keeps a retired object on; embedded in every object it may retire
+class HazardRetirable {
+public:
+    HazardRetirable() {
+    }
+    // Only ever set on an object that is dead already, so copies start unlinked
+    HazardRetirable(const HazardRetirable&) {
+    }
+    HazardRetirable& operator=(const HazardRetirable&) {
+        return *this;
+    }
+
+private:
+    friend class HazardDomain;
+
+    void* object_ = nullptr;
+    void (*destroy_)(void*) = nullptr;
+    HazardRetirable* next_ = nullptr;
+};
+
+class HazardDomain {
+public:
+    static constexpr size_t kDefaultScanThreshold = 64;
+
+    HazardDomain() {
+    }
+
+    HazardDomain(const HazardDomain&) = delete;
+    HazardDomain& operator=(const HazardDomain&) = delete;
+
+    // No reader may be active anymore
+    ~HazardDomain() {
+        while (HazardRetirable* list = retired_.exchange(nullptr, std::memory_order_acquire)) {
+            Free(list);
+        }
+        Record* record = records_.load(std::memory_order_acquire);
+        while (record != nullptr) {
+            Record* next = record->next;
+            delete record;
+            record = next;
+        }
+    }
+
+    // Objects may still be retired from static destructors
+    static HazardDomain& Default() {
+        return NeverDestroyed<HazardDomain, HazardDomain>();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Tuning
+
+    // Number of pending retirements that triggers a scan; larger values amortize the scan over
+    // more objects at the cost of memory held back
+    void SetScanThreshold(size_t threshold) {
+        scan_threshold_.store(threshold, std::memory_order_relaxed);
+    }
+    size_t GetScanThreshold() const {
+        return scan_threshold_.load(std::memory_order_relaxed);
+    }
+
+    size_t GetRetiredCount() const {
+        return retired_count_.load(std::memory_order_relaxed);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Reclamation
+
+    // `node` lives inside `object` and goes with it; `object` is the address readers protect
+    void Retire(HazardRetirable* node, void* object, void (*destroy)(void*)) {
+        node->object_ = object;
+        node->destroy_ = destroy;
+        Push(node);
+        if (retired_count_.fetch_add(1, std::memory_order_relaxed) + 1 >= GetScanThreshold()) {
+            Reclaim();
+        }
+    }
+
+    // Frees every retired object that no hazard pointer protects; a concurrent scan wins
+    void Reclaim() {
+        // Not a mutex: destructors run by the scan may retire more objects on this thread
+        if (scanning_.exchange(true, std::memory_order_acquire)) {
+            return;
+        }
+        HazardRetirable* list = retired_.exchange(nullptr, std::memory_order_acquire);
+        // Pairs with the fence in `HazardPointer::Protect`
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::unordered_set<void*> protect;
+        for (Record* record = records_.load(std::memory_order_acquire); record != nullptr;
+             record = record->next) {
+            if (void* ptr = record->hazard.load(std::memory_order_acquire)) {
+                protect.insert(ptr);
+            }
+        }
+        size_t freed = 0;
+        while (list != nullptr) {
+            HazardRetirable* next = list->next_;
+            if (protect.count(list->object_) != 0) {
+                Push(list);
+            } else {
+                list->destroy_(list->object_);
+                ++freed;
+            }
+            list = next;
+        }
+        retired_count_.fetch_sub(freed, std::memory_order_relaxed);
+        scanning_.store(false, std::memory_order_release);
+    }
+
+private:
+    struct Record {
+        std::atomic<void*> hazard = nullptr;
+        std::atomic<bool> active = true;
+        Record* next = nullptr;
+    };
+
+    std::atomic<Record*> records_ = nullptr;
+    std::atomic<HazardRetirable*> retired_ = nullptr;
+    std::atomic<size_t> retired_count_ = 0;
+    std::atomic<size_t> scan_threshold_ = kDefaultScanThreshold;
+    std::atomic<bool> scanning_ = false;
+
+    friend class HazardPointer;
+
+    // Records are recycled, never unlinked, so readers can walk the list without locks
+    Record* Acquire() {
+        for (Record* record = records_.load(std::memory_order_acquire); record != nullptr;
+             record = record->next) {
+            bool active = false;
+            if (!record->active.load(std::memory_order_relaxed) &&
+                record->active.compare_exchange_strong(active, true,
+                                                       std::memory_order_acquire)) {
+                return record;
+            }
+        }
+        auto record = new Record();
+        record->next = records_.load(std::memory_order_relaxed);
+        while (!records_.compare_exchange_weak(record->next, record, std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+        }
+        return record;
+    }
+
+    void Push(HazardRetirable* node) {
+        node->next_ = retired_.load(std::memory_order_relaxed);
+        while (!retired_.compare_exchange_weak(node->next_, node, std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+        }
+    }
+
+    // Destroying an object frees its node, so the link is read first
+    static void Free(HazardRetirable* list) {
+        while (list != nullptr) {
+            HazardRetirable* next = list->next_;
+            list->destroy_(list->object_);
+            list = next;
+        }
+    }
+};
+
+// A reader's slot in a `HazardDomain`: while it names an object, the domain will not free it
+class HazardPointer {
+public:
+    explicit HazardPointer(HazardDomain& domain = HazardDomain::Default())
+        : record_(domain.Acquire()) {
+    }
+
+    HazardPointer(const HazardPointer&) = delete;
+    HazardPointer& operator=(const HazardPointer&) = delete;
+
+    ~HazardPointer() {
+        Reset();
+        record_->active.store(false, std::memory_order_release);
+    }
+
+    // Loads `source` and keeps the result alive until the next `Protect` or `Reset`
+    template <typename T>
+    T* Protect(const std::atomic<T*>& source) {
+        T* ptr = source.load(std::memory_order_relaxed);
+        while (true) {
+            record_->hazard.store(ptr, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            T* current = source.load(std::memory_order_acquire);
+            if (current == ptr) {
+                return ptr;
+            }
+            ptr = current;
+        }
+    }
+
+    void Reset() {
+        record_->hazard.store(nullptr, std::memory_order_release);
+    }
+
+private:
+    HazardDomain::Record* record_;
+};
+
+// `RefCounted` deleter policy: an object whose count reaches zero is retired into `Domain()` and
+// destroyed with `D` once no reader protects it. The object carries the `HazardRetirable` link
+template <typename D = DefaultDelete, HazardDomain& (*Domain)() = &HazardDomain::Default>
+struct RetireDelete {
+    template <typename T>
+    static void Destroy(T* object) {
+        static_assert(std::is_base_of_v<HazardRetirable, T>,
+                      "RetireDelete needs a type derived from HazardRetirable");
+        if (object) {
+            Domain().Retire(object, object, [](void* ptr) {
+                D::Destroy(static_cast<T*>(ptr));
+            });
+        }
+    }
+};
+
+template <typename Derived, HazardDomain& (*Domain)() = &HazardDomain::Default>
+class HazardRefCounted
+    : public RefCounted<Derived, ThreadSafeCounter, RetireDelete<DefaultDelete, Domain>>,
+      public HazardRetirable {};
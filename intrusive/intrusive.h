@@ -1,13 +1,34 @@
 #pragma once
 
+#include "unique/compressed_pair.h"
+#include "unique/relocate.h"
+#include "unique/stats.h"
+
+#include <algorithm>
+#include <atomic>
 #include <cstddef>  // for std::nullptr_t
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <memory_resource>
 #include <type_traits>
 #include <utility>  // for std::exchange / std::swap
-#include <iostream>
 
-class SimpleCounter {
+// Taking one more reference than a narrow counter can hold
+class RefCountOverflow : public std::exception {};
+
+// `Int` is the counter width: narrow ones save space on small objects and throw
+// `RefCountOverflow` instead of wrapping around
+template <typename Int>
+class BasicCounter {
 public:
+    static_assert(std::is_unsigned_v<Int>);
+
     size_t IncRef() {
+        if (count_ == std::numeric_limits<Int>::max()) {
+            throw RefCountOverflow();
+        }
         count_++;
         return count_;
     }
@@ -20,9 +41,59 @@ public:
     }
 
 private:
-    size_t count_ = 0;
+    Int count_ = 0;
+};
+
+// Relaxed increments; only the decrement that reaches zero synchronizes with the others
+template <typename Int>
+class BasicThreadSafeCounter {
+public:
+    static_assert(std::is_unsigned_v<Int>);
+
+    BasicThreadSafeCounter() {
+    }
+    // A copied object starts with its own references
+    BasicThreadSafeCounter(const BasicThreadSafeCounter&) {
+    }
+    BasicThreadSafeCounter& operator=(const BasicThreadSafeCounter&) {
+        return *this;
+    }
+
+    // Racing increments may overshoot the limit before they back off, so it sits at half range
+    size_t IncRef() {
+        Int count = count_.fetch_add(1, std::memory_order_relaxed);
+        if (count >= kLimit) {
+            count_.fetch_sub(1, std::memory_order_relaxed);
+            throw RefCountOverflow();
+        }
+        return size_t(count) + 1;
+    }
+    size_t DecRef() {
+        Int count = count_.fetch_sub(1, std::memory_order_release) - 1;
+        if (count == 0) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+        }
+        return count;
+    }
+    size_t RefCount() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr Int kLimit = std::numeric_limits<Int>::max() / 2;
+
+    std::atomic<Int> count_ = 0;
 };
 
+using SimpleCounter = BasicCounter<size_t>;
+using ThreadSafeCounter = BasicThreadSafeCounter<size_t>;
+
+static_assert(sizeof(BasicCounter<uint16_t>) == 2 && sizeof(BasicCounter<uint32_t>) == 4 &&
+              sizeof(BasicCounter<uint64_t>) == 8);
+static_assert(sizeof(BasicThreadSafeCounter<uint16_t>) == 2 &&
+              sizeof(BasicThreadSafeCounter<uint32_t>) == 4 &&
+              sizeof(BasicThreadSafeCounter<uint64_t>) == 8);
+
 struct DefaultDelete {
     template <typename T>
     static void Destroy(T* object) {
@@ -32,15 +103,89 @@ struct DefaultDelete {
     }
 };
 
+// Stored right before every object created by `AllocateIntrusive`, so that a deleter finds it
+// from the address of the complete object, whatever the type the deleter sees
+struct AllocationHeader {
+    void (*destroy)(void* object);
+};
+
+inline AllocationHeader* GetAllocationHeader(void* object) {
+    return reinterpret_cast<AllocationHeader*>(static_cast<char*>(object) -
+                                               sizeof(AllocationHeader));
+}
+
+// Layout of an `AllocateIntrusive` allocation: the header, the object right behind it, then the
+// allocator, which takes no space when empty
+template <typename T, typename Alloc>
+class IntrusiveAllocation {
+public:
+    using BlockAlloc =
+        typename std::allocator_traits<Alloc>::template rebind_alloc<IntrusiveAllocation>;
+
+    explicit IntrusiveAllocation(const Alloc& alloc) : alloc_(alloc) {
+        new (GetAllocationHeader(GetObject())) AllocationHeader{&Destroy};
+    }
+
+    T* GetObject() {
+        return reinterpret_cast<T*>(storage_ + kObjectOffset);
+    }
+    Alloc& GetAllocator() {
+        return alloc_;
+    }
+
+private:
+    // A multiple of both alignments, so the header before the object is aligned as well
+    static constexpr size_t kObjectOffset =
+        (sizeof(AllocationHeader) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+    alignas(std::max(alignof(T), alignof(AllocationHeader))) char storage_[kObjectOffset +
+                                                                           sizeof(T)];
+    [[no_unique_address]] Alloc alloc_;
+
+    static void Destroy(void* object) {
+        auto self = reinterpret_cast<IntrusiveAllocation*>(static_cast<char*>(object) -
+                                                           kObjectOffset);
+        Alloc alloc = self->alloc_;
+        std::allocator_traits<Alloc>::destroy(alloc, static_cast<T*>(object));
+        self->~IntrusiveAllocation();
+        BlockAlloc block_alloc(alloc);
+        std::allocator_traits<BlockAlloc>::deallocate(block_alloc, self, 1);
+    }
+};
+
+// Deleter for objects created by `AllocateIntrusive`
+struct AllocatedDelete {
+    template <typename T>
+    static void Destroy(T* object) {
+        if (object) {
+            // The header precedes the complete object, which may be of a type derived from `T`
+            void* complete;
+            if constexpr (std::is_polymorphic_v<T>) {
+                complete = dynamic_cast<void*>(object);
+            } else {
+                complete = object;
+            }
+            GetAllocationHeader(complete)->destroy(complete);
+        }
+    }
+};
+
 template <typename Derived, typename Counter, typename Deleter>
 class RefCounted {
 public:
+    using CountedType = Derived;
+    using DeleterType = Deleter;
+
     void IncRef() {
-        counter_.IncRef();
+        stats_.Count(StatsEvent::kStrongInc);
+        stats_.Use(counter_.IncRef());
     }
 
     void DecRef() {
+        stats_.Count(StatsEvent::kStrongDec);
         if (counter_.DecRef() == 0) {
+            stats_.Die();
+            stats_.Count(StatsEvent::kFree);
             Deleter().Destroy(static_cast<Derived*>(this));
         }
     }
@@ -51,11 +196,29 @@ public:
 
 private:
     Counter counter_;
+    [[no_unique_address]] SelfTrackedStatsTag<Derived> stats_;
 };
 
 template <typename Derived, typename D = DefaultDelete>
 using SimpleRefCounted = RefCounted<Derived, SimpleCounter, D>;
 
+template <typename Derived, typename D = DefaultDelete>
+using ThreadSafeRefCounted = RefCounted<Derived, ThreadSafeCounter, D>;
+
+// Counted in `Int`, e.g. `uint16_t` for objects that are never shared widely
+template <typename Derived, typename Int, typename D = DefaultDelete>
+using SizedRefCounted = RefCounted<Derived, BasicCounter<Int>, D>;
+
+template <typename Derived, typename Int, typename D = DefaultDelete>
+using ThreadSafeSizedRefCounted = RefCounted<Derived, BasicThreadSafeCounter<Int>, D>;
+
+#if !POINTER_STATS
+// The counter is the whole footprint
+static_assert(sizeof(SizedRefCounted<void, uint16_t>) == 2);
+static_assert(sizeof(ThreadSafeSizedRefCounted<void, uint32_t>) == 4);
+static_assert(sizeof(SimpleRefCounted<void>) == sizeof(size_t));
+#endif
+
 template <typename T>
 class IntrusivePtr {
     template <typename Y>
@@ -73,6 +236,14 @@ public:
             ptr_->IncRef();
         }
     }
+    // With `add_ref == false` adopts a reference the caller already holds. An object nobody
+    // counted yet has no reference to adopt, so it gets its first one here
+    IntrusivePtr(T* ptr, bool add_ref) {
+        ptr_ = ptr;
+        if (ptr_ && (add_ref || ptr_->RefCount() == 0)) {
+            ptr_->IncRef();
+        }
+    }
 
     template <typename Y>
     IntrusivePtr(const IntrusivePtr<Y>& other) {
@@ -83,7 +254,7 @@ public:
     }
 
     template <typename Y>
-    IntrusivePtr(IntrusivePtr<Y>&& other) {
+    IntrusivePtr(IntrusivePtr<Y>&& other) noexcept {
         ptr_ = other.ptr_;
         other.ptr_ = nullptr;
     }
@@ -94,7 +265,7 @@ public:
             ptr_->IncRef();
         }
     }
-    IntrusivePtr(IntrusivePtr&& other) {
+    IntrusivePtr(IntrusivePtr&& other) noexcept {
         ptr_ = other.ptr_;
         other.ptr_ = nullptr;
     }
@@ -113,9 +284,8 @@ public:
         }
         return *this;
     }
-    IntrusivePtr& operator=(IntrusivePtr&& other) {
-        if (ptr_ == other.ptr_) {
-            // other.ptr_ = nullptr;
+    IntrusivePtr& operator=(IntrusivePtr&& other) noexcept {
+        if (this == &other) {
             return *this;
         }
         if (ptr_) {
@@ -129,16 +299,12 @@ public:
     // Destructor
     ~IntrusivePtr() {
         if (ptr_) {
-            if (UseCount() == 0) {
-                delete ptr_;
-                return;
-            }
             ptr_->DecRef();
         }
     }
 
     // Modifiers
-    void Reset() {
+    void Reset() noexcept {
         if (ptr_) {
             ptr_->DecRef();
         }
@@ -156,8 +322,14 @@ public:
             ptr_->IncRef();
         }
     }
-    void Swap(IntrusivePtr& other) {
-        swap(ptr_, other.ptr_);
+    void Swap(IntrusivePtr& other) noexcept {
+        std::swap(ptr_, other.ptr_);
+    }
+    // Gives up ownership without touching the counter
+    T* Detach() noexcept {
+        T* ptr = ptr_;
+        ptr_ = nullptr;
+        return ptr;
     }
 
     T* Get() const {
@@ -183,8 +355,92 @@ private:
     T* ptr_ = nullptr;
 };
 
+namespace detail {
+// Only names a counted type for the checks below
+struct NothrowCheck : SimpleRefCounted<NothrowCheck> {};
+}  // namespace detail
+
+static_assert(std::is_nothrow_move_constructible_v<IntrusivePtr<detail::NothrowCheck>> &&
+              std::is_nothrow_move_assignable_v<IntrusivePtr<detail::NothrowCheck>> &&
+              std::is_nothrow_swappable_v<IntrusivePtr<detail::NothrowCheck>> &&
+              std::is_nothrow_destructible_v<IntrusivePtr<detail::NothrowCheck>>);
+
+template <typename T>
+struct IsTriviallyRelocatable<IntrusivePtr<T>> : std::true_type {};
+
 template <typename T, typename... Args>
 IntrusivePtr<T> MakeIntrusive(Args&&... args) {
     IntrusivePtr<T> intr_ptr = IntrusivePtr<T>(new T(std::forward<Args>(args)...));
     return intr_ptr;
 }
+
+// Pointer casts: the rvalue overloads move the reference over instead of copying it
+
+template <typename T, typename U>
+IntrusivePtr<T> StaticPointerCast(const IntrusivePtr<U>& other) {
+    return IntrusivePtr<T>(static_cast<T*>(other.Get()));
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> StaticPointerCast(IntrusivePtr<U>&& other) {
+    return IntrusivePtr<T>(static_cast<T*>(other.Detach()), false);
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> ConstPointerCast(const IntrusivePtr<U>& other) {
+    return IntrusivePtr<T>(const_cast<T*>(other.Get()));
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> ConstPointerCast(IntrusivePtr<U>&& other) {
+    return IntrusivePtr<T>(const_cast<T*>(other.Detach()), false);
+}
+
+// On failure the result is empty and `other` keeps its object
+template <typename T, typename U>
+IntrusivePtr<T> DynamicPointerCast(const IntrusivePtr<U>& other) {
+    return IntrusivePtr<T>(dynamic_cast<T*>(other.Get()));
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> DynamicPointerCast(IntrusivePtr<U>&& other) {
+    T* ptr = dynamic_cast<T*>(other.Get());
+    if (ptr == nullptr) {
+        return IntrusivePtr<T>();
+    }
+    other.Detach();
+    return IntrusivePtr<T>(ptr, false);
+}
+
+// `alloc` is a standard allocator or a `std::pmr::memory_resource*`; `T` must use
+// `AllocatedDelete` so that the object is returned to it
+template <typename T, typename Alloc, typename... Args>
+IntrusivePtr<T> AllocateIntrusive(const Alloc& alloc, Args&&... args) {
+    static_assert(std::is_same_v<typename T::DeleterType, AllocatedDelete>,
+                  "AllocateIntrusive needs a RefCounted<..., AllocatedDelete> type");
+    // The deleter sees the `RefCounted` type and reaches a derived object only through RTTI
+    static_assert(std::is_same_v<typename T::CountedType, T> ||
+                      std::is_polymorphic_v<typename T::CountedType>,
+                  "AllocateIntrusive of a type derived from a non-polymorphic RefCounted type");
+    if constexpr (std::is_convertible_v<Alloc, std::pmr::memory_resource*>) {
+        return AllocateIntrusive<T>(std::pmr::polymorphic_allocator<std::byte>(alloc),
+                                    std::forward<Args>(args)...);
+    } else {
+        using ObjectAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+        using Block = IntrusiveAllocation<T, ObjectAlloc>;
+        using BlockAlloc = typename Block::BlockAlloc;
+        BlockAlloc block_alloc(alloc);
+        Block* cur = std::allocator_traits<BlockAlloc>::allocate(block_alloc, 1);
+        new (cur) Block(ObjectAlloc(alloc));
+        T* object = cur->GetObject();
+        try {
+            std::allocator_traits<ObjectAlloc>::construct(cur->GetAllocator(), object,
+                                                          std::forward<Args>(args)...);
+        } catch (...) {
+            cur->~Block();
+            std::allocator_traits<BlockAlloc>::deallocate(block_alloc, cur, 1);
+            throw;
+        }
+        return IntrusivePtr<T>(object);
+    }
+}
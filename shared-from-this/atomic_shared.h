@@ -0,0 +1,174 @@
+#pragma once
+
+#include "sw_fwd.h"  // Forward declaration
+#include "shared.h"
+#include "weak.h"
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+// https://en.cppreference.com/w/cpp/memory/shared_ptr/atomic2
+
+// Lock-free atomic slot for `SharedPtr` / `WeakPtr`, based on split reference counting.
+//
+// The stored pointer lives in an immutable node (a `ControlBlockObj<Ptr>`). The slot is a
+// single 64-bit word: the node address in the low 48 bits and a count of in-flight readers
+// in the high 16 bits. A reader bumps that local count with one `fetch_add`, which keeps the
+// node alive while it copies the pointer out, and then gives its claim back. A writer that
+// swaps the node out moves the local count into the node's strong count, so readers that
+// lost the race release their claim there instead.
+//
+// Every node is pre-paid with `kBias` strong references so that those releases cannot free
+// it before the writer has settled the transferred claims.
+template <typename Ptr>
+class AtomicPtr {
+    using Node = ControlBlockObj<Ptr>;
+
+    static constexpr int kPointerBits = 48;
+    static constexpr uint64_t kOneClaim = uint64_t(1) << kPointerBits;
+    static constexpr uint64_t kPointerMask = kOneClaim - 1;
+    static constexpr int kBias = 1 << (64 - kPointerBits);
+
+    static_assert(sizeof(void*) == sizeof(uint64_t), "AtomicPtr needs 64-bit pointers");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    AtomicPtr() {
+    }
+
+    AtomicPtr(Ptr desired) : word_(MakeNode(std::move(desired))) {
+    }
+
+    AtomicPtr(const AtomicPtr&) = delete;
+    AtomicPtr& operator=(const AtomicPtr&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~AtomicPtr() {
+        Retire(word_.load(std::memory_order_acquire));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Operations
+
+    Ptr Load() const {
+        uint64_t claimed = word_.fetch_add(kOneClaim, std::memory_order_acquire);
+        Node* node = GetNode(claimed);
+        if (node == nullptr) {
+            ReleaseClaim(node);
+            return Ptr();
+        }
+        Ptr result = *node->GetPtr();
+        ReleaseClaim(node);
+        return result;
+    }
+
+    void Store(Ptr desired) {
+        Exchange(std::move(desired));
+    }
+
+    Ptr Exchange(Ptr desired) {
+        uint64_t old = word_.exchange(MakeNode(std::move(desired)), std::memory_order_acq_rel);
+        Ptr result = GetNode(old) ? *GetNode(old)->GetPtr() : Ptr();
+        Retire(old);
+        return result;
+    }
+
+    // On failure `expected` receives the current value
+    bool CompareExchange(Ptr& expected, Ptr desired) {
+        uint64_t desired_word = MakeNode(std::move(desired));
+        while (true) {
+            uint64_t claimed = word_.fetch_add(kOneClaim, std::memory_order_acquire);
+            Node* node = GetNode(claimed);
+            if (!IsSame(node, expected)) {
+                Ptr current = node ? *node->GetPtr() : Ptr();
+                expected.Swap(current);
+                ReleaseClaim(node);
+                Retire(desired_word);
+                return false;
+            }
+            uint64_t current = claimed + kOneClaim;
+            while (GetNode(current) == node) {
+                if (word_.compare_exchange_weak(current, desired_word, std::memory_order_acq_rel,
+                                                std::memory_order_relaxed)) {
+                    // Our own claim went along with the old word
+                    ReleaseClaim(node);
+                    Retire(current);
+                    return true;
+                }
+            }
+            // Replaced under us: compare against the new value
+            ReleaseClaim(node);
+        }
+    }
+
+    bool IsLockFree() const {
+        return word_.is_lock_free();
+    }
+
+private:
+    mutable std::atomic<uint64_t> word_ = 0;
+
+    static Node* GetNode(uint64_t word) {
+        return reinterpret_cast<Node*>(word & kPointerMask);
+    }
+
+    static ControlBlock* GetBlock(Node* node) {
+        return *node;
+    }
+
+    static uint64_t MakeNode(Ptr desired) {
+        if (desired.block_ == nullptr) {
+            return 0;
+        }
+        Node* node = new Node(std::move(desired));
+        GetBlock(node)->AddStrong(kBias);
+        return reinterpret_cast<uint64_t>(node);
+    }
+
+    static bool IsSame(Node* node, const Ptr& expected) {
+        if (node == nullptr) {
+            return expected.block_ == nullptr;
+        }
+        return node->GetPtr()->block_ == expected.block_ &&
+               node->GetPtr()->observed_ == expected.observed_;
+    }
+
+    void ReleaseClaim(Node* node) const {
+        uint64_t current = word_.load(std::memory_order_relaxed);
+        // Claims on an empty slot are simply dropped when it is overwritten
+        while (GetNode(current) == node && (current >> kPointerBits) != 0) {
+            if (word_.compare_exchange_weak(current, current - kOneClaim,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+                return;
+            }
+        }
+        // The writer that swapped `node` out moved our claim into its strong count
+        if (node != nullptr) {
+            GetBlock(node)->DecStrong();
+        }
+    }
+
+    // Drops the slot's reference on a word that is no longer reachable from `word_`
+    static void Retire(uint64_t word) {
+        Node* node = GetNode(word);
+        if (node == nullptr) {
+            return;
+        }
+        int claims = static_cast<int>(word >> kPointerBits);
+        GetBlock(node)->AddStrong(claims - kBias);
+        GetBlock(node)->DecStrong();
+    }
+};
+
+template <typename T>
+using AtomicSharedPtr = AtomicPtr<SharedPtr<T>>;
+
+template <typename T>
+using AtomicWeakPtr = AtomicPtr<WeakPtr<T>>;
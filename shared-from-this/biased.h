@@ -0,0 +1,178 @@
+#pragma once
+
+#include "unique/lifetime.h"
+
+#include <atomic>
+#include <cstdint>
+
+// Opt-in biased reference counting for control blocks, cf. Choi, Shull, Torrellas, "Biased
+// Reference Counting" (PACT 2018) and CPython's free-threaded build.
+//
+// A block is biased to the thread that creates it: that thread counts its references in a plain
+// `int`, every other thread in the atomic shared count. The shared count never drops below zero
+// while the block is unmerged; a non-owner that would take it there hands its reference to the
+// owner's queue instead. The owner merges its count into the shared one when it drops to zero,
+// for queued blocks in `FlushBiasedQueue()`, and when the thread exits. Blocks of an owner that
+// has already exited are merged by the first thread that finds out.
+//
+// A queue is a lock-free list linked through the blocks themselves: a block is linked once
+// however many references it carries, so handing one over never locks or allocates. Queues are
+// recycled across threads and never freed, so finding an owner's queue walks them without locks.
+
+#ifndef BIASED_REFCOUNT
+#define BIASED_REFCOUNT 0
+#endif
+
+template <typename Block>
+class BiasedRegistry {
+public:
+    // Never an owner: threads that have not created a block yet, or are tearing down
+    static constexpr uint64_t kNoThread = ~uint64_t(0);
+
+    static uint64_t ThreadId() {
+        Queue* queue = LocalQueues::Peek();
+        return queue != nullptr ? queue->id.load(std::memory_order_relaxed) : kNoThread;
+    }
+
+    // Owner of a block created on this thread, 0 (born merged) once the thread is exiting
+    static uint64_t OwnerForNewBlock() {
+        Queue* queue = LocalQueues::Get();
+        if (queue == nullptr) {
+            return 0;
+        }
+        if (queue->head.load(std::memory_order_relaxed) != nullptr) {
+            Drain(*queue);
+        }
+        return queue->id.load(std::memory_order_relaxed);
+    }
+
+    // Passes a reference on `block` to its owner; false if the owner has exited, in which case
+    // the block has been merged and the reference must go through the shared count
+    static bool Push(uint64_t owner, Block* block) {
+        // Already queued: whoever linked it hands this reference over as well
+        if (block->queued_.fetch_add(1, std::memory_order_acq_rel) != 0) {
+            return true;
+        }
+        Queue* queue = Find(owner);
+        if (queue != nullptr && Link(*queue, block)) {
+            return true;
+        }
+        // Ours is the last of the references counted in `queued_`
+        block->MergeOrphaned(owner);
+        int queued = block->queued_.exchange(0, std::memory_order_acq_rel);
+        while (--queued > 0) {
+            block->DecStrong();
+        }
+        return false;
+    }
+
+    // Merges `block` now if its `owner` has exited
+    static void MergeIfOrphaned(uint64_t owner, Block* block) {
+        Queue* queue = Find(owner);
+        if (queue == nullptr || queue->head.load(std::memory_order_acquire) == Closed()) {
+            block->MergeOrphaned(owner);
+        }
+    }
+
+    static void Flush() {
+        if (Queue* queue = LocalQueues::Peek()) {
+            Drain(*queue);
+        }
+    }
+
+private:
+    struct Queue {
+        explicit Queue(uint64_t id) : id(id) {
+        }
+
+        // `kNoThread` while no thread holds the queue
+        std::atomic<uint64_t> id;
+        // Blocks with references handed to the owner, linked through `Block::queue_next_`;
+        // `Closed()` from the owner's exit until the queue is reused
+        std::atomic<Block*> head = nullptr;
+        Queue* next = nullptr;
+    };
+
+    // A thread takes a queue on its first block and gives it back when it exits
+    struct QueueTraits {
+        using Resource = Queue;
+
+        static Queue* Create() {
+            static std::atomic<uint64_t> next_id = 1;
+            uint64_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+            for (Queue* queue = AllQueues().load(std::memory_order_acquire); queue != nullptr;
+                 queue = queue->next) {
+                uint64_t free = kNoThread;
+                if (queue->id.load(std::memory_order_relaxed) == kNoThread &&
+                    queue->id.compare_exchange_strong(free, id, std::memory_order_acq_rel)) {
+                    queue->head.store(nullptr, std::memory_order_relaxed);
+                    return queue;
+                }
+            }
+            auto queue = new Queue(id);
+            queue->next = AllQueues().load(std::memory_order_relaxed);
+            while (!AllQueues().compare_exchange_weak(queue->next, queue,
+                                                      std::memory_order_release,
+                                                      std::memory_order_relaxed)) {
+            }
+            return queue;
+        }
+
+        static void Destroy(Queue* queue) {
+            // Stay open until the queue is empty, so nobody else merges our blocks
+            Block* empty = nullptr;
+            do {
+                Drain(*queue);
+                empty = nullptr;
+            } while (!queue->head.compare_exchange_strong(empty, Closed(),
+                                                          std::memory_order_acq_rel));
+            queue->id.store(kNoThread, std::memory_order_release);
+        }
+    };
+    using LocalQueues = ThreadResource<QueueTraits>;
+
+    // Blocks may be released from static destructors, so the list is never torn down
+    static std::atomic<Queue*>& AllQueues() {
+        static std::atomic<Queue*> queues = nullptr;
+        return queues;
+    }
+
+    static Block* Closed() {
+        static char closed;
+        return reinterpret_cast<Block*>(&closed);
+    }
+
+    // A queue found here may be reused by another thread right after; a block linked into it
+    // then reaches that thread, which releases it as any non-owner does
+    static Queue* Find(uint64_t owner) {
+        for (Queue* queue = AllQueues().load(std::memory_order_acquire); queue != nullptr;
+             queue = queue->next) {
+            if (queue->id.load(std::memory_order_acquire) == owner) {
+                return queue;
+            }
+        }
+        return nullptr;
+    }
+
+    static bool Link(Queue& queue, Block* block) {
+        Block* head = queue.head.load(std::memory_order_relaxed);
+        do {
+            if (head == Closed()) {
+                return false;
+            }
+            block->queue_next_ = head;
+        } while (!queue.head.compare_exchange_weak(head, block, std::memory_order_release,
+                                                   std::memory_order_relaxed));
+        return true;
+    }
+
+    static void Drain(Queue& queue) {
+        Block* block = queue.head.exchange(nullptr, std::memory_order_acquire);
+        while (block != nullptr) {
+            // Read first: once its count is taken the block may be queued again, or freed
+            Block* next = block->queue_next_;
+            block->MergeQueued(block->queued_.exchange(0, std::memory_order_acq_rel));
+            block = next;
+        }
+    }
+};
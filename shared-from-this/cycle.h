@@ -0,0 +1,375 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Opt-in collector of `SharedPtr` cycles: synchronous trial deletion after Bacon and Rajan,
+// "Concurrent Cycle Collection in Reference Counted Systems" (ECOOP 2001).
+//
+// With `CYCLE_COLLECTOR`, a release that leaves the strong count of a traced object above zero
+// buffers its block as a candidate root, on a lock-free stack linked through the blocks. `Collect` takes the candidates in slices and subtracts
+// the references internal to the subgraph reachable from them; whatever is still referenced from
+// outside stays, along with everything it reaches. The rest is garbage: the collector resets the
+// `SharedPtr`-s the trace hooks visit and lets ordinary counting destroy the objects.
+//
+// The `SharedPtr`-s a trace hook visits must not be written concurrently with `Collect`; other
+// references may come and go, and a slice in which a garbage count moves collects nothing. A
+// `WeakPtr` locked while its cycle is being broken may see the members already reset.
+
+#ifndef CYCLE_COLLECTOR
+#define CYCLE_COLLECTOR 0
+#endif
+
+// Specialize as `std::true_type` with a `template <typename Visitor> static void Trace(T&,
+// Visitor& visit)` that calls `visit(ptr)` on every `SharedPtr` member that may lead back
+template <typename T>
+struct CycleTrace : std::false_type {};
+
+struct CycleStats {
+    size_t roots = 0;
+    size_t traced = 0;
+    size_t collected = 0;
+    // Candidates left for the next call once the budget ran out
+    size_t remaining = 0;
+};
+
+template <typename Block>
+class CycleCollector {
+public:
+    // Candidates taken per slice; the budget is checked between slices
+    static constexpr size_t kSliceRoots = 64;
+    static constexpr std::chrono::milliseconds kDefaultBudget{10};
+
+    // Passed to trace hooks: lists the children, or takes their references over
+    class Visitor {
+    public:
+        template <typename Ptr>
+        void operator()(Ptr& ptr) {
+            if (steal_) {
+                Steal(ptr, *out_);
+            } else if (Block* block = BlockOf(ptr)) {
+                out_->push_back(block);
+            }
+        }
+
+    private:
+        friend CycleCollector;
+
+        std::vector<Block*>* out_;
+        bool steal_;
+
+        Visitor(std::vector<Block*>& out, bool steal) : out_(&out), steal_(steal) {
+        }
+    };
+
+    // Takes over a weak reference on `block`, held until the candidate is taken; dropped at once
+    // if the block is buffered already or its object is gone
+    static void Buffer(Block* block) {
+        if (block->GetStrongCount() == 0 ||
+            block->cycle_.buffered_.exchange(true, std::memory_order_relaxed)) {
+            block->DecWeak();
+            return;
+        }
+        CandidateCount().fetch_add(1, std::memory_order_relaxed);
+        auto& next = block->cycle_.next_;
+        next = Candidates().load(std::memory_order_relaxed);
+        while (!Candidates().compare_exchange_weak(next, block, std::memory_order_release,
+                                                   std::memory_order_relaxed)) {
+        }
+    }
+
+    static size_t GetCandidateCount() {
+        return CandidateCount().load(std::memory_order_relaxed);
+    }
+
+    // Runs slices until the budget runs out or as many candidates as were buffered when it
+    // started are taken, so threads that keep buffering more cannot hold it; at least one slice
+    // if any. A call made while another one is running returns at once.
+    static CycleStats Collect(std::chrono::nanoseconds budget) {
+        CycleStats stats;
+        if (Running().exchange(true, std::memory_order_acquire)) {
+            return stats;
+        }
+        auto start = std::chrono::steady_clock::now();
+        size_t quota = GetCandidateCount();
+        std::vector<Block*> roots;
+        do {
+            TakeRoots(roots, std::min(kSliceRoots, quota));
+            if (roots.empty()) {
+                break;
+            }
+            quota -= roots.size();
+            CollectSlice(roots, stats);
+            roots.clear();
+        } while (quota != 0 && std::chrono::steady_clock::now() - start < budget);
+        Running().store(false, std::memory_order_release);
+        stats.remaining = GetCandidateCount();
+        return stats;
+    }
+
+private:
+    enum Color : uint8_t { kUnseen, kGray, kLive };
+
+    template <typename Ptr>
+    static Block* BlockOf(Ptr& ptr) {
+        return ptr.block_;
+    }
+
+    template <typename Ptr>
+    static void Steal(Ptr& ptr, std::vector<Block*>& out) {
+        if (ptr.block_ != nullptr) {
+            out.push_back(ptr.block_);
+            ptr.block_ = nullptr;
+            ptr.observed_ = nullptr;
+        }
+    }
+
+    // Trivially destructible, as blocks may be released from static destructors
+    static std::atomic<Block*>& Candidates() {
+        static std::atomic<Block*> head = nullptr;
+        return head;
+    }
+    static std::atomic<size_t>& CandidateCount() {
+        static std::atomic<size_t> count = 0;
+        return count;
+    }
+
+    static std::atomic<bool>& Running() {
+        static std::atomic<bool> running = false;
+        return running;
+    }
+
+    // Block whose release by the collector must not buffer it again
+    static Block*& Releasing() {
+        static thread_local Block* block = nullptr;
+        return block;
+    }
+
+    // Only the running `Collect` pops, so a block cannot leave and come back between the load of
+    // its link and the exchange
+    static void TakeRoots(std::vector<Block*>& roots, size_t count) {
+        Block* block = Candidates().load(std::memory_order_acquire);
+        while (block != nullptr && roots.size() < count) {
+            if (!Candidates().compare_exchange_weak(block, block->cycle_.next_,
+                                                    std::memory_order_acquire)) {
+                continue;
+            }
+            CandidateCount().fetch_sub(1, std::memory_order_relaxed);
+            block->cycle_.buffered_.store(false, std::memory_order_relaxed);
+            roots.push_back(block);
+            block = Candidates().load(std::memory_order_acquire);
+        }
+    }
+
+    static bool IsTraced(Block* block) {
+        return block->cycle_.trace_ != nullptr;
+    }
+
+    static void Trace(Block* block, std::vector<Block*>& out, bool steal) {
+        Visitor visit(out, steal);
+        block->cycle_.trace_(block->cycle_.object_, visit);
+    }
+
+    static void Reach(Block* block, std::vector<Block*>& nodes) {
+        auto& node = block->cycle_;
+        if (node.color_ != kUnseen) {
+            return;
+        }
+        node.color_ = kGray;
+        node.count_ = block->GetExactStrongCount();
+        // Counts only the owner thread knows are taken as external references
+        node.trial_ = node.count_ < 0 ? INT_MAX : node.count_;
+        nodes.push_back(block);
+    }
+
+    // Only a hook racing with a writer could lead to a block without strong owners
+    static bool IsAlive(Block* block) {
+        return block->cycle_.count_ != 0;
+    }
+
+    static void CollectSlice(const std::vector<Block*>& roots, CycleStats& stats) {
+        // Held strongly for the slice, so no root dies under the tracing
+        std::vector<Block*> held;
+        for (Block* root : roots) {
+            if (root->TryIncStrong()) {
+                held.push_back(root);
+            }
+        }
+
+        // Trial deletion: every traced edge between reached blocks is subtracted
+        std::vector<Block*> nodes;
+        for (Block* root : held) {
+            Reach(root, nodes);
+            --root->cycle_.trial_;
+        }
+        std::vector<Block*> children;
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (!IsAlive(nodes[i])) {
+                continue;
+            }
+            Trace(nodes[i], children, false);
+            for (Block* child : children) {
+                if (IsTraced(child)) {
+                    Reach(child, nodes);
+                    --child->cycle_.trial_;
+                }
+            }
+            children.clear();
+        }
+
+        // Blocks referenced from outside keep alive everything they reach
+        std::vector<Block*> live;
+        for (Block* node : nodes) {
+            if (node->cycle_.trial_ > 0 && node->cycle_.color_ == kGray) {
+                node->cycle_.color_ = kLive;
+                live.push_back(node);
+            }
+            while (!live.empty()) {
+                Block* block = live.back();
+                live.pop_back();
+                if (!IsAlive(block)) {
+                    continue;
+                }
+                Trace(block, children, false);
+                for (Block* child : children) {
+                    if (IsTraced(child) && child->cycle_.color_ == kGray) {
+                        child->cycle_.color_ = kLive;
+                        live.push_back(child);
+                    }
+                }
+                children.clear();
+            }
+        }
+
+        std::vector<Block*> garbage;
+        for (Block* node : nodes) {
+            if (node->cycle_.color_ == kGray) {
+                garbage.push_back(node);
+            }
+        }
+        for (Block* block : garbage) {
+            if (block->GetExactStrongCount() != block->cycle_.count_) {
+                garbage.clear();
+                break;
+            }
+        }
+
+        // Each garbage object stays alive until all of their references are taken over
+        std::vector<Block*> stolen;
+        for (Block* block : garbage) {
+            block->IncStrong();
+        }
+        for (Block* block : garbage) {
+            Trace(block, stolen, true);
+        }
+        for (Block* node : nodes) {
+            node->cycle_.color_ = kUnseen;
+        }
+        stats.roots += roots.size();
+        stats.traced += nodes.size();
+        stats.collected += garbage.size();
+
+        for (Block* block : stolen) {
+            block->DecStrong();
+        }
+        for (Block* block : garbage) {
+            ReleaseQuietly(block);
+        }
+        for (Block* block : held) {
+            ReleaseQuietly(block);
+        }
+        for (Block* root : roots) {
+            root->DecWeak();
+        }
+    }
+
+    static void ReleaseQuietly(Block* block) {
+        Releasing() = block;
+        block->DecStrong();
+        Releasing() = nullptr;
+    }
+
+    template <typename>
+    friend class CycleHook;
+};
+
+// Per-block part of the collector; empty unless `CYCLE_COLLECTOR`
+template <typename Block>
+class CycleHook {
+public:
+#if CYCLE_COLLECTOR
+    template <typename T>
+    void Link(T* object) {
+        using U = std::remove_cv_t<T>;
+        if constexpr (CycleTrace<U>::value) {
+            if (object != nullptr) {
+                object_ = const_cast<U*>(object);
+                trace_ = [](void* object, typename CycleCollector<Block>::Visitor& visit) {
+                    CycleTrace<U>::Trace(*static_cast<U*>(object), visit);
+                };
+            }
+        }
+    }
+
+    // Buffers the block when it goes out of scope, so that the collector never takes a root
+    // while the release that buffered it is still to drop its count
+    class PendingRoot {
+    public:
+        explicit PendingRoot(Block* block = nullptr) : block_(block) {
+        }
+
+        PendingRoot(const PendingRoot&) = delete;
+        PendingRoot& operator=(const PendingRoot&) = delete;
+
+        ~PendingRoot() {
+            if (block_ != nullptr) {
+                CycleCollector<Block>::Buffer(block_);
+            }
+        }
+
+    private:
+        Block* block_;
+    };
+
+    // Called before `released` references are dropped, while the block is surely still there;
+    // keep the result until they are. Only releases that look like they leave the object alive
+    // buffer it, and the weak reference taken here keeps the block around until then.
+    [[nodiscard]] PendingRoot PossibleRoot(Block* block, int released) {
+        if (trace_ != nullptr && !buffered_.load(std::memory_order_relaxed) &&
+            block->GetStrongCount() > released &&
+            block != CycleCollector<Block>::Releasing()) {
+            block->IncWeak();
+            return PendingRoot(block);
+        }
+        return PendingRoot();
+    }
+
+private:
+    friend CycleCollector<Block>;
+
+    void* object_ = nullptr;
+    void (*trace_)(void*, typename CycleCollector<Block>::Visitor&) = nullptr;
+    std::atomic<bool> buffered_ = false;
+    // The next candidate while the block is buffered
+    Block* next_ = nullptr;
+    // Scratch of the running slice, only touched by the collector
+    uint8_t color_ = 0;
+    int count_ = 0;
+    int trial_ = 0;
+#else
+    struct PendingRoot {};
+
+    template <typename T>
+    void Link(T*) {
+    }
+    PendingRoot PossibleRoot(Block*, int) {
+        return PendingRoot();
+    }
+#endif
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+// Opt-in deferred strong decrements.
+//
+// While a `DeferredDecrementScope` is alive on a thread, `SharedPtr`-s released there log their
+// control block in a per-thread buffer instead of decrementing it. The buffer is applied when it
+// fills up, on `FlushDeferredDecrements()` and when the outermost scope ends; releases of the
+// same block are merged into one `DecStrong(count)`. Objects therefore live until the next flush.
+// Both buffers are allocated when the outermost scope starts, so deferring never allocates;
+// releases that find the pending buffer full in the middle of a flush are applied on the spot.
+
+template <typename Block>
+class DeferredDecrements {
+public:
+    static constexpr size_t kDefaultCapacity = 1024;
+
+private:
+    struct Buffer {
+        std::unique_ptr<Block*[]> blocks;
+        // Swapped with `blocks` while applying, since destructors may defer more releases
+        std::unique_ptr<Block*[]> applying;
+        size_t size = 0;
+        size_t capacity = kDefaultCapacity;
+        bool flushing = false;
+    };
+
+public:
+    // False if deferral is off on this thread and the caller has to decrement itself
+    static bool Defer(Block* block) noexcept {
+        Buffer* buffer = Current();
+        if (buffer == nullptr || buffer->size == buffer->capacity) {
+            return false;
+        }
+        buffer->blocks[buffer->size++] = block;
+        if (buffer->size == buffer->capacity) {
+            Flush(*buffer);
+        }
+        return true;
+    }
+
+    static void Flush() {
+        if (Buffer* buffer = Current()) {
+            Flush(*buffer);
+        }
+    }
+
+    // The outermost scope owns the buffer; nested ones only share it
+    class Scope {
+    public:
+        explicit Scope(size_t capacity = kDefaultCapacity) {
+            if (Current() == nullptr) {
+                buffer_.capacity = std::max<size_t>(capacity, 1);
+                buffer_.blocks.reset(new Block*[buffer_.capacity]);
+                buffer_.applying.reset(new Block*[buffer_.capacity]);
+                Current() = &buffer_;
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope() {
+            if (Current() == &buffer_) {
+                Flush(buffer_);
+                Current() = nullptr;
+            }
+        }
+
+    private:
+        Buffer buffer_;
+    };
+
+private:
+    static Buffer*& Current() {
+        static thread_local Buffer* buffer = nullptr;
+        return buffer;
+    }
+
+    static void Flush(Buffer& buffer) noexcept {
+        // A flush triggered from inside a flush is left to the outer loop
+        if (buffer.flushing) {
+            return;
+        }
+        buffer.flushing = true;
+        while (buffer.size != 0) {
+            Block** begin = buffer.blocks.get();
+            Block** end = begin + buffer.size;
+            buffer.blocks.swap(buffer.applying);
+            buffer.size = 0;
+            std::sort(begin, end);
+            for (Block** it = begin; it != end;) {
+                Block** run = std::upper_bound(it, end, *it);
+                (*it)->DecStrong(static_cast<int>(run - it));
+                it = run;
+            }
+        }
+        buffer.flushing = false;
+    }
+};
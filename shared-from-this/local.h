@@ -0,0 +1,245 @@
+#pragma once
+
+#include "sw_fwd.h"  // Forward declaration
+#include "shared.h"
+
+#include <cstddef>  // std::nullptr_t
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Thread-confined `SharedPtr`, cf. boost::local_shared_ptr
+
+// All `LocalSharedPtr`-s of one object together hold a single strong reference of the atomic
+// `ControlBlock` and count themselves with a plain integer.
+class LocalCounter {
+public:
+    explicit LocalCounter(ControlBlock* block) : block_(block) {
+    }
+
+    void IncLocal() {
+        ++local_counter_;
+    }
+    void DecLocal() {
+        if (--local_counter_ == 0) {
+            block_->DecStrong();
+        }
+    }
+
+    int GetLocalCount() const {
+        return local_counter_;
+    }
+
+    ControlBlock* GetBlock() const {
+        return block_;
+    }
+
+    bool IsOwnerThread() const {
+        return owner_ == std::this_thread::get_id();
+    }
+
+private:
+    ControlBlock* block_;
+    int local_counter_ = 1;
+    std::thread::id owner_ = std::this_thread::get_id();
+};
+
+// `ControlBlockPtr` / `ControlBlockObj` with the local counter in the same allocation
+template <typename Block>
+class LocalControlBlock : public Block {
+public:
+    template <typename... Args>
+    LocalControlBlock(Args&&... args) : Block(std::forward<Args>(args)...), local_(*this) {
+    }
+
+    LocalCounter* GetLocal() {
+        return &local_;
+    }
+
+private:
+    LocalCounter local_;
+};
+
+template <typename T>
+class LocalSharedPtr {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    LocalSharedPtr() {
+    }
+    LocalSharedPtr(std::nullptr_t) {
+    }
+
+    explicit LocalSharedPtr(T* ptr) {
+        local_ = NewBlock<T, LocalControlBlock<ControlBlockPtr<T>>>(ptr)->GetLocal();
+        observed_ = ptr;
+        PutWeakThis();
+    }
+
+    template <typename U>
+    explicit LocalSharedPtr(U* ptr) {
+        local_ = NewBlock<U, LocalControlBlock<ControlBlockPtr<U>>>(ptr)->GetLocal();
+        observed_ = ptr;
+        PutWeakThis();
+    }
+
+    template <typename Y>
+    LocalSharedPtr(const LocalSharedPtr<Y>& other) {
+        local_ = other.local_;
+        observed_ = other.observed_;
+        if (local_ != nullptr) {
+            local_->IncLocal();
+        }
+    }
+
+    template <typename Y>
+    LocalSharedPtr(LocalSharedPtr<Y>&& other) noexcept {
+        local_ = other.local_;
+        observed_ = other.observed_;
+        other.observed_ = nullptr;
+        other.local_ = nullptr;
+    }
+
+    LocalSharedPtr(const LocalSharedPtr& other) {
+        local_ = other.local_;
+        observed_ = other.observed_;
+        if (local_ != nullptr) {
+            local_->IncLocal();
+        }
+    }
+
+    LocalSharedPtr(LocalSharedPtr&& other) noexcept {
+        local_ = other.local_;
+        observed_ = other.observed_;
+        other.observed_ = nullptr;
+        other.local_ = nullptr;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    LocalSharedPtr& operator=(const LocalSharedPtr& other) {
+        if (local_ == other.local_) {
+            observed_ = other.observed_;
+            return *this;
+        }
+        Clear();
+        local_ = other.local_;
+        observed_ = other.observed_;
+        if (local_ != nullptr) {
+            local_->IncLocal();
+        }
+        return *this;
+    }
+
+    LocalSharedPtr& operator=(LocalSharedPtr&& other) noexcept {
+        if (this == &other) {
+            return *this;
+        }
+        Clear();
+        local_ = other.local_;
+        observed_ = other.observed_;
+        other.observed_ = nullptr;
+        other.local_ = nullptr;
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~LocalSharedPtr() {
+        Clear();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() noexcept {
+        Clear();
+        local_ = nullptr;
+        observed_ = nullptr;
+    }
+
+    template <typename U>
+    void Reset(U* ptr) {
+        LocalSharedPtr(ptr).Swap(*this);
+    }
+
+    void Swap(LocalSharedPtr& other) noexcept {
+        std::swap(local_, other.local_);
+        std::swap(observed_, other.observed_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return observed_;
+    }
+    T& operator*() const {
+        return *observed_;
+    }
+    T* operator->() const {
+        return observed_;
+    }
+    // Number of `LocalSharedPtr`-s owning the object; promoted `SharedPtr`-s are not counted
+    size_t UseCount() const {
+        if (!local_) {
+            return 0;
+        }
+        return local_->GetLocalCount();
+    }
+    explicit operator bool() const {
+        return (observed_ != nullptr);
+    }
+
+private:
+    LocalCounter* local_ = nullptr;
+    T* observed_ = nullptr;
+
+    void Clear() {
+        if (local_ != nullptr) {
+            local_->DecLocal();
+        }
+    }
+
+    void PutWeakThis() {
+        if constexpr (std::is_convertible_v<T*, ESFTBase*>) {
+            if (observed_) {
+                SharedPtr<T>(*this).PutWeakThis();
+            }
+        }
+    }
+
+    template <typename Y>
+    friend class LocalSharedPtr;
+
+    template <typename Y>
+    friend class SharedPtr;
+
+    template <typename U, typename... Args>
+    friend LocalSharedPtr<U> MakeLocalShared(Args&&... args);
+};
+
+static_assert(std::is_nothrow_move_constructible_v<LocalSharedPtr<int>> &&
+              std::is_nothrow_move_assignable_v<LocalSharedPtr<int>> &&
+              std::is_nothrow_swappable_v<LocalSharedPtr<int>>);
+
+template <typename T>
+struct IsTriviallyRelocatable<LocalSharedPtr<T>> : std::true_type {};
+
+template <typename T, typename U>
+inline bool operator==(const LocalSharedPtr<T>& left, const LocalSharedPtr<U>& right) {
+    return left.Get() == right.Get();
+}
+
+template <typename T, typename... Args>
+LocalSharedPtr<T> MakeLocalShared(Args&&... args) {
+    LocalSharedPtr<T> local;
+    auto cur = NewBlock<T, LocalControlBlock<ControlBlockObj<T>>>(std::forward<Args>(args)...);
+    local.local_ = cur->GetLocal();
+    local.observed_ = cur->GetPtr();
+    local.PutWeakThis();
+    return local;
+}
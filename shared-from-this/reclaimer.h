@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+// Background destruction of shared objects.
+//
+// Blocks of types with `UseBackgroundReclaim` set, and blocks made by `MakeSharedReclaimed`,
+// do not destroy their object on the thread that drops the last strong reference. They are
+// pushed onto a bounded queue served by one reclaimer thread, which destroys the object and
+// releases the block. The queue is a ring allocated up front and the thread starts with the
+// reclaimer, when the first such block is made, so a release never allocates or spawns. Work
+// that finds the queue full, is pushed from the reclaimer itself, or after `Shutdown` runs
+// inline.
+
+// Specialize to destroy every `SharedPtr`-owned `T` on the reclaimer thread
+template <typename T>
+struct UseBackgroundReclaim : std::false_type {};
+
+class BackgroundReclaimer {
+public:
+    static constexpr size_t kDefaultCapacity = 4096;
+
+    struct Stats {
+        size_t depth = 0;
+        size_t max_depth = 0;
+        size_t enqueued = 0;
+        size_t reclaimed = 0;
+        // Pushes that found the queue full and reclaimed inline
+        size_t overflows = 0;
+    };
+
+    // Never destroyed; the reclaimer thread is drained and joined at exit
+    static BackgroundReclaimer& Instance() {
+        static auto reclaimer = new BackgroundReclaimer();
+        static ShutdownGuard guard;
+        return *reclaimer;
+    }
+
+    BackgroundReclaimer(const BackgroundReclaimer&) = delete;
+    BackgroundReclaimer& operator=(const BackgroundReclaimer&) = delete;
+
+    void Push(void* block, void (*reclaim)(void*)) {
+        std::unique_lock lock(mutex_);
+        bool run_inline = stopping_ || IsWorker();
+        if (!run_inline && size_ >= capacity_) {
+            ++stats_.overflows;
+            run_inline = true;
+        }
+        if (run_inline) {
+            lock.unlock();
+            reclaim(block);
+            return;
+        }
+        ring_[(head_ + size_) % ring_size_] = Task{block, reclaim};
+        ++size_;
+        ++stats_.enqueued;
+        stats_.max_depth = std::max(stats_.max_depth, size_);
+        lock.unlock();
+        not_empty_.notify_one();
+    }
+
+    // Waits until everything pushed so far has been reclaimed. Returns at once on the reclaimer
+    // thread, e.g. from a destructor it runs, which would otherwise wait for itself
+    void Drain() {
+        if (IsWorker()) {
+            return;
+        }
+        std::unique_lock lock(mutex_);
+        idle_.wait(lock, [this] { return size_ == 0 && !busy_; });
+    }
+
+    // Drains the queue and stops the thread; later releases are reclaimed inline
+    void Shutdown() {
+        {
+            std::lock_guard lock(mutex_);
+            if (stopping_) {
+                return;
+            }
+            stopping_ = true;
+        }
+        not_empty_.notify_all();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+    }
+
+    // Growing the ring allocates here, never in `Push`
+    void SetCapacity(size_t capacity) {
+        capacity = std::max<size_t>(capacity, 1);
+        std::unique_ptr<Task[]> ring;
+        if (capacity > ring_size_) {
+            ring.reset(new Task[capacity]);
+        }
+        std::lock_guard lock(mutex_);
+        if (ring && capacity > ring_size_) {
+            for (size_t i = 0; i < size_; ++i) {
+                ring[i] = ring_[(head_ + i) % ring_size_];
+            }
+            ring_.swap(ring);
+            ring_size_ = capacity;
+            head_ = 0;
+        }
+        capacity_ = capacity;
+    }
+
+    Stats GetStats() const {
+        std::lock_guard lock(mutex_);
+        Stats stats = stats_;
+        stats.depth = size_;
+        return stats;
+    }
+
+private:
+    struct Task {
+        void* block;
+        void (*reclaim)(void*);
+    };
+
+    struct ShutdownGuard {
+        ~ShutdownGuard() {
+            Instance().Shutdown();
+        }
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable idle_;
+    // `size_` tasks from `head_` on; `capacity_` may be below `ring_size_` after a shrink
+    std::unique_ptr<Task[]> ring_;
+    size_t ring_size_ = kDefaultCapacity;
+    size_t head_ = 0;
+    size_t size_ = 0;
+    size_t capacity_ = kDefaultCapacity;
+    bool busy_ = false;
+    bool stopping_ = false;
+    Stats stats_;
+    std::thread worker_;
+    std::thread::id worker_id_;
+
+    BackgroundReclaimer() : ring_(new Task[kDefaultCapacity]) {
+        worker_ = std::thread([this] { Run(); });
+        worker_id_ = worker_.get_id();
+    }
+
+    bool IsWorker() const {
+        return std::this_thread::get_id() == worker_id_;
+    }
+
+    void Run() {
+        std::unique_lock lock(mutex_);
+        while (true) {
+            not_empty_.wait(lock, [this] { return size_ != 0 || stopping_; });
+            if (size_ == 0) {
+                break;
+            }
+            Task task = ring_[head_];
+            head_ = (head_ + 1) % ring_size_;
+            --size_;
+            busy_ = true;
+            lock.unlock();
+            task.reclaim(task.block);
+            lock.lock();
+            busy_ = false;
+            ++stats_.reclaimed;
+            if (size_ == 0) {
+                idle_.notify_all();
+            }
+        }
+        idle_.notify_all();
+    }
+};
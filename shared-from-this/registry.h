@@ -0,0 +1,151 @@
+#pragma once
+
+#include "unique/lifetime.h"
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <vector>
+
+// Opt-in registry of live control blocks, for hunting leaked owners and "zombie" blocks that
+// only `WeakPtr`-s keep around after the object is gone.
+//
+// With `BLOCK_REGISTRY` every block links itself into one of `kShards` lists, picked by the
+// creating thread, and unlinks right before it is freed. Walking a shard holds its lock, which
+// also keeps its blocks from being freed under the walker.
+
+#ifndef BLOCK_REGISTRY
+#define BLOCK_REGISTRY 0
+#endif
+
+struct BlockInfo {
+    const char* name;
+    size_t bytes;
+    int strong;
+    int weak;
+    bool alive;
+};
+
+struct BlockTypeReport {
+    std::string name;
+    size_t live_blocks = 0;
+    size_t live_bytes = 0;
+    // Object destroyed, block still held by weak owners
+    size_t expired_blocks = 0;
+    size_t expired_bytes = 0;
+};
+
+template <typename Block>
+class BlockRegistry {
+public:
+    static constexpr size_t kShards = 16;
+
+    struct Node {
+        Block* block = nullptr;
+        const char* name = nullptr;
+        size_t bytes = 0;
+        size_t shard = 0;
+        Node* prev = nullptr;
+        Node* next = nullptr;
+    };
+
+    static void Link(Node& node) {
+        node.shard = std::hash<std::thread::id>()(std::this_thread::get_id()) % kShards;
+        Shard& shard = Shards()[node.shard];
+        std::lock_guard lock(shard.mutex);
+        node.next = shard.head;
+        if (shard.head != nullptr) {
+            shard.head->prev = &node;
+        }
+        shard.head = &node;
+    }
+
+    static void Unlink(Node& node) {
+        Shard& shard = Shards()[node.shard];
+        std::lock_guard lock(shard.mutex);
+        if (node.prev != nullptr) {
+            node.prev->next = node.next;
+        } else {
+            shard.head = node.next;
+        }
+        if (node.next != nullptr) {
+            node.next->prev = node.prev;
+        }
+    }
+
+    // `visit` runs with a shard locked: it must not create or free blocks
+    template <typename Visitor>
+    static void ForEachBlock(Visitor&& visit) {
+        for (Shard& shard : Shards()) {
+            std::lock_guard lock(shard.mutex);
+            for (Node* node = shard.head; node != nullptr; node = node->next) {
+                int strong = node->block->GetStrongCount();
+                visit(BlockInfo{node->name, node->bytes, strong, node->block->GetWeakCount(),
+                                strong != 0});
+            }
+        }
+    }
+
+    static std::vector<BlockTypeReport> ReportByType() {
+        std::map<std::string, BlockTypeReport> by_name;
+        ForEachBlock([&](const BlockInfo& info) {
+            BlockTypeReport& report = by_name[info.name];
+            if (info.alive) {
+                ++report.live_blocks;
+                report.live_bytes += info.bytes;
+            } else {
+                ++report.expired_blocks;
+                report.expired_bytes += info.bytes;
+            }
+        });
+        std::vector<BlockTypeReport> result;
+        for (auto& [name, report] : by_name) {
+            report.name = name;
+            result.push_back(std::move(report));
+        }
+        return result;
+    }
+
+private:
+    struct Shard {
+        std::mutex mutex;
+        Node* head = nullptr;
+    };
+
+    // Blocks may be freed from static destructors
+    static std::array<Shard, kShards>& Shards() {
+        return NeverDestroyed<std::array<Shard, kShards>, BlockRegistry>();
+    }
+};
+
+// Per-block part of the registry; empty unless `BLOCK_REGISTRY`
+template <typename Block>
+class RegistryHook {
+public:
+#if BLOCK_REGISTRY
+    template <typename T>
+    void Link(Block* block, size_t bytes) {
+        node_.block = block;
+        node_.name = typeid(T).name();
+        node_.bytes = bytes;
+        BlockRegistry<Block>::Link(node_);
+    }
+    void Unlink() {
+        BlockRegistry<Block>::Unlink(node_);
+    }
+
+private:
+    typename BlockRegistry<Block>::Node node_;
+#else
+    template <typename T>
+    void Link(Block*, size_t) {
+    }
+    void Unlink() {
+    }
+#endif
+};
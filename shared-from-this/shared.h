@@ -1,11 +1,24 @@
 #pragma once
 
-#include "catch.hpp"
 // #include "shared-from-this/weak.h"
 #include "sw_fwd.h"  // Forward declaration
-
+#include "biased.h"
+#include "cycle.h"
+#include "deferred.h"
+#include "reclaimer.h"
+#include "registry.h"
+#include "slab.h"
+#include "unique/compressed_pair.h"
+#include "unique/unique.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>  // std::nullptr_t
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
 #include <type_traits>
 #include <utility>
 
@@ -15,170 +28,532 @@ class EnableSharedFromThis;
 
 class ESFTBase;
 
+// Selects default- instead of value-initialization of the object
+struct ForOverwriteTag {};
+
+inline constexpr size_t kCacheLineSize = 64;
+
+// Specialize to give every `MakeShared<T>` object a cache line of its own, as `MakeSharedPadded`
+// does: threads that copy and drop pointers then stop invalidating the line readers of the
+// object's first fields are on
+template <typename T>
+struct UsePaddedControlBlock : std::false_type {};
+
+// Counting is non-virtual; only destroying the object and freeing the block are type-erased
 class ControlBlock {
 public:
-    // ControlBlock() {}
-    virtual void IncStrong() {
+#if BIASED_REFCOUNT
+    ControlBlock() : owner_(Biased::OwnerForNewBlock()) {
+        if (owner_.load(std::memory_order_relaxed) == 0) {
+            local_counter_ = 0;
+            counters_.store(kWeakOne | kStrongOne | kMerged, std::memory_order_relaxed);
+        }
     }
+#endif
 
-    virtual void DecStrong() {
+    void IncStrong() {
+        stats_.Count(StatsEvent::kStrongInc);
+#if BIASED_REFCOUNT
+        if (IsOwner()) {
+            stats_.Use(++local_counter_);
+            return;
+        }
+#endif
+        int count = Strong(counters_.fetch_add(kStrongOne, std::memory_order_relaxed));
+        stats_.Use((count >> kShift) + 1);
+    }
+    void DecStrong() {
+        stats_.Count(StatsEvent::kStrongDec);
+        [[maybe_unused]] auto root = cycle_.PossibleRoot(this, 1);
+#if BIASED_REFCOUNT
+        if (IsOwner()) {
+            if (--local_counter_ == 0 && MergeLocal()) {
+                stats_.Die();
+                DestroyObject();
+                DecWeak();
+            }
+            return;
+        }
+        uint64_t counters = counters_.load(std::memory_order_relaxed);
+        while (true) {
+            // The rest of the references are counted by the owner: let it drop this one
+            if ((Strong(counters) & kMerged) == 0 && Strong(counters) < kStrongOne) {
+                if (Biased::Push(owner_.load(std::memory_order_relaxed), this)) {
+                    return;
+                }
+                counters = counters_.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (counters_.compare_exchange_weak(counters, counters - kStrongOne,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        if (Strong(counters) == (kStrongOne | kMerged)) {
+#else
+        // The only owner and no weak ones: nobody else can reach the block, so one load does
+        if (counters_.load(std::memory_order_acquire) == (kWeakOne | kStrongOne)) {
+            counters_.store(kWeakOne, std::memory_order_relaxed);
+            stats_.Die();
+            DestroyObject();
+            DecWeak();
+            return;
+        }
+        if (Strong(counters_.fetch_sub(kStrongOne, std::memory_order_release)) == 1) {
+#endif
+            std::atomic_thread_fence(std::memory_order_acquire);
+            stats_.Die();
+            DestroyObject();
+            DecWeak();
+        }
     }
 
-    virtual int GetStrongCount() {
-        return 0;
+    // Drops `count` references at once
+    void DecStrong(int count) {
+#if BIASED_REFCOUNT
+        // Each release may land in either count, so they cannot be folded together
+        while (count-- > 0) {
+            DecStrong();
+        }
+#else
+        stats_.Count(StatsEvent::kStrongDec, count);
+        [[maybe_unused]] auto root = cycle_.PossibleRoot(this, count);
+        if (Strong(counters_.fetch_sub(uint64_t(count) * kStrongOne,
+                                       std::memory_order_release)) == count) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            stats_.Die();
+            DestroyObject();
+            DecWeak();
+        }
+#endif
     }
 
-    virtual void IncWeak(){};
+    // Exact without `BIASED_REFCOUNT`. With it, an unmerged block reports a lower bound off the
+    // owning thread, and may run high on it: a release that another thread handed to the owner's
+    // queue still counts until the owner drains it, in `FlushBiasedQueue()`, when it creates its
+    // next block, or when it exits
+    int GetStrongCount() const {
+#if BIASED_REFCOUNT
+        int count = Strong(counters_.load(std::memory_order_relaxed));
+        if ((count & kMerged) != 0) {
+            return count >> kShift;
+        }
+        return (count >> kShift) + (IsOwner() ? local_counter_ : 1);
+#else
+        return Strong(counters_.load(std::memory_order_relaxed));
+#endif
+    }
 
-    virtual void DecWeak(){};
+    // Takes a strong reference unless the object is already gone; used to promote weak owners
+    bool TryIncStrong() {
+#if BIASED_REFCOUNT
+        // An unmerged block is still held by its owner
+        if (IsOwner()) {
+            stats_.Count(StatsEvent::kStrongInc);
+            ++local_counter_;
+            return true;
+        }
+        uint64_t counters = counters_.load(std::memory_order_relaxed);
+        while (Strong(counters) != kMerged) {
+#else
+        uint64_t counters = counters_.load(std::memory_order_relaxed);
+        while (Strong(counters) != 0) {
+#endif
+            if (counters_.compare_exchange_weak(counters, counters + kStrongOne,
+                                                std::memory_order_relaxed)) {
+                stats_.Count(StatsEvent::kStrongInc);
+                return true;
+            }
+        }
+        return false;
+    }
 
-    virtual int GetWeakCount() {
-        return 0;
-    };
+    void IncWeak() {
+        stats_.Count(StatsEvent::kWeakInc);
+        counters_.fetch_add(kWeakOne, std::memory_order_relaxed);
+    }
+    void DecWeak() {
+        stats_.Count(StatsEvent::kWeakDec);
+        // A count of one means we hold the last reference: nobody can observe the block
+        // anymore, so skip the read-modify-write.
+        if (Weak(counters_.load(std::memory_order_acquire)) == 1 ||
+            Weak(counters_.fetch_sub(kWeakOne, std::memory_order_release)) == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            stats_.Count(StatsEvent::kFree);
+            registry_.Unlink();
+            Deallocate();
+        }
+    }
+
+    int GetWeakCount() const {
+        return Weak(counters_.load(std::memory_order_relaxed)) - (GetStrongCount() != 0);
+    }
+
+    // Bulk adjustment for owners that pre-pay strong references; must never reach zero
+    void AddStrong(int count) {
+        counters_.fetch_add(uint64_t(count) * kStrongOne, std::memory_order_relaxed);
+    }
 
-    // virtual auto GetPtr() {}
     virtual ~ControlBlock() noexcept {
     }
 
-private:
-    int strong_counter_ = 0;
-    int weak_counter_ = 0;
-    template <typename T>
-    friend class ControlBlockPtr;
-    template <typename T>
-    friend class ControlBlockObj;
-    template <typename T>
-    friend class SharedPtr;
-    // friend class ControlBlockPtr;
-    // friend class ControlBlockObj;
-};
+protected:
+    virtual void DestroyObject() = 0;
+    virtual void Deallocate() = 0;
 
-template <typename T>
-class ControlBlockPtr : ControlBlock {
-public:
-    ControlBlockPtr(T* ptr = nullptr) : ptr_(ptr) {
-        this->IncStrong();
+    // Every block calls this with the type it owns, its own size and the object if it has one
+    template <typename T>
+    void Track(size_t bytes, T* object = nullptr) {
+        stats_.Track<T>();
+        registry_.Link<T>(this, bytes);
+        cycle_.Link(object);
     }
 
-    void IncStrong() override {
-        this->strong_counter_++;
+private:
+#if BIASED_REFCOUNT
+    // The strong half holds the shared count above a flag set once the owner's count is folded in
+    static constexpr int kShift = 1;
+    static constexpr int kMerged = 1;
+#else
+    static constexpr int kShift = 0;
+#endif
+    static constexpr int kStrongOne = 1 << kShift;
+    static constexpr uint64_t kWeakOne = uint64_t(1) << 32;
+
+    static int Strong(uint64_t counters) {
+        return static_cast<int32_t>(static_cast<uint32_t>(counters));
     }
-    void DecStrong() override {
-        if (this->strong_counter_ == 1) {
-            if (this->weak_counter_ == 0) {
-                delete this;
-                return;
-            } else {
-                delete ptr_;
-                ptr_ = nullptr;
+    static int Weak(uint64_t counters) {
+        return static_cast<int>(counters >> 32);
+    }
+
+    // The weak count above the strong one, so a single load or atomic op sees both. Blocks are
+    // born with one strong owner. Strong owners together hold one extra weak reference, so
+    // whoever drops the weak count to zero frees the block.
+    std::atomic<uint64_t> counters_ = kWeakOne | (BIASED_REFCOUNT ? 0 : kStrongOne);
+    [[no_unique_address]] StatsTag stats_;
+    [[no_unique_address]] RegistryHook<ControlBlock> registry_;
+    [[no_unique_address]] CycleHook<ControlBlock> cycle_;
+
+    friend CycleCollector<ControlBlock>;
+
+    // What the cycle collector may rely on: -1 for an unmerged block of a live thread
+    int GetExactStrongCount() {
+#if BIASED_REFCOUNT
+        if ((Strong(counters_.load(std::memory_order_relaxed)) & kMerged) == 0 && !IsOwner()) {
+            Biased::MergeIfOrphaned(owner_.load(std::memory_order_relaxed), this);
+            if ((Strong(counters_.load(std::memory_order_relaxed)) & kMerged) == 0) {
+                return -1;
             }
         }
-        this->strong_counter_--;
-        if (strong_counter_ == 0 && weak_counter_ == 0) {
-            delete this;
-        }
+#endif
+        return GetStrongCount();
     }
 
-    int GetStrongCount() override {
-        return this->strong_counter_;
+#if BIASED_REFCOUNT
+    using Biased = BiasedRegistry<ControlBlock>;
+    friend Biased;
+
+    // 0 once merged; otherwise only the owner touches `local_counter_`
+    std::atomic<uint64_t> owner_;
+    int local_counter_ = 1;
+    // While in the owner's queue: the next block there and the references handed over
+    ControlBlock* queue_next_ = nullptr;
+    std::atomic<int> queued_ = 0;
+
+    bool IsOwner() const {
+        return owner_.load(std::memory_order_relaxed) == Biased::ThreadId();
     }
 
-    void IncWeak() override {
-        this->weak_counter_++;
+    // Folds the owner's count into the shared one; true if no reference is left
+    bool MergeLocal() {
+        int local = local_counter_;
+        local_counter_ = 0;
+        owner_.store(0, std::memory_order_relaxed);
+        int count = Strong(counters_.fetch_add((uint64_t(local) << kShift) | kMerged,
+                                               std::memory_order_acq_rel));
+        return (count >> kShift) + local == 0;
     }
-    void DecWeak() override {
-        if (this->weak_counter_ == 1 && this->strong_counter_ == 0) {
-            delete this;
-            return;
+
+    // Called once `owner` has exited; the first thread to find out does the merge
+    void MergeOrphaned(uint64_t owner) {
+        if (owner != 0 && owner_.compare_exchange_strong(owner, 0, std::memory_order_acquire)) {
+            MergeLocal();
         }
-        this->weak_counter_--;
     }
 
-    int GetWeakCount() override {
-        return this->weak_counter_;
+    // Drops the `count` references handed over by `Biased::Push`
+    void MergeQueued(int count) {
+        if (IsOwner()) {
+            MergeLocal();
+        }
+        while (count-- > 0) {
+            DecStrong();
+        }
+    }
+#endif
+};
+
+#if !BIASED_REFCOUNT && !POINTER_STATS && !BLOCK_REGISTRY && !CYCLE_COLLECTOR
+// The vtable pointer and the counter word; the opt-in features above add their own fields
+static_assert(sizeof(ControlBlock) == sizeof(void*) + sizeof(uint64_t));
+#endif
+
+using DeferredDecrementScope = DeferredDecrements<ControlBlock>::Scope;
+
+// Applies the releases deferred on this thread so far; a no-op outside a scope
+inline void FlushDeferredDecrements() {
+    DeferredDecrements<ControlBlock>::Flush();
+}
+
+// Call at quiet points of a long-lived thread to release references other threads handed to
+// the blocks it created; a no-op without `BIASED_REFCOUNT`
+inline void FlushBiasedQueue() {
+#if BIASED_REFCOUNT
+    BiasedRegistry<ControlBlock>::Flush();
+#endif
+}
+
+// Breaks the garbage cycles among the buffered candidates, stopping after the first slice that
+// ends past `budget` or once the candidates buffered at the start are done; call again while
+// `remaining` is not zero. A no-op without `CYCLE_COLLECTOR`
+inline CycleStats CollectCycles([[maybe_unused]] std::chrono::nanoseconds budget =
+                                    CycleCollector<ControlBlock>::kDefaultBudget) {
+#if CYCLE_COLLECTOR
+    return CycleCollector<ControlBlock>::Collect(budget);
+#else
+    return CycleStats();
+#endif
+}
+
+template <typename T, typename Deleter = Slug<T>>
+class ControlBlockPtr : ControlBlock, public SlabAllocated<T> {
+public:
+    ControlBlockPtr(T* ptr = nullptr) : object_(ptr, Deleter()) {
+        Track<T>(sizeof(ControlBlockPtr), ptr);
+    }
+    ControlBlockPtr(T* ptr, Deleter deleter) : object_(ptr, std::move(deleter)) {
+        Track<T>(sizeof(ControlBlockPtr), ptr);
     }
 
     operator ControlBlock*() {
         return this;
     }
 
-    ~ControlBlockPtr() override {
-        delete ptr_;
+protected:
+    void DestroyObject() override {
+        object_.GetSecond()(object_.GetFirst());
+        object_.GetFirst() = nullptr;
+    }
+    void Deallocate() override {
+        delete this;
     }
 
 private:
-    T* ptr_;
+    // A stateless deleter takes no space
+    CompressedPair<T*, Deleter> object_;
 };
 
-template <typename T>
-class ControlBlockObj : ControlBlock {
+template <typename T, bool kPadded = UsePaddedControlBlock<std::remove_cv_t<T>>::value>
+class ControlBlockObj : ControlBlock, public SlabAllocated<T> {
 public:
-    // ControlBlockObj(T& obj) : obj_(obj) {
-    //     this->IncStrong();
-    // }
-    // template <typename Y>
-
     template <typename U, typename... Args>
     friend SharedPtr<U> MakeShared(Args&&... args);
 
     template <typename... Args>
     ControlBlockObj(Args&&... args) {
-        new (GetPtr()) T(std::forward<Args>(args)...);
-        this->IncStrong();
+        new (std::addressof(storage_)) T(std::forward<Args>(args)...);
+        Track<T>(sizeof(ControlBlockObj), GetPtr());
+    }
+    ControlBlockObj(ForOverwriteTag) {
+        new (std::addressof(storage_)) T;
+        Track<T>(sizeof(ControlBlockObj), GetPtr());
     }
 
     operator ControlBlock*() {
         return this;
     }
 
-    ~ControlBlockObj() override {
-        // reinterpret_cast<T*>(std::addressof(storage_)) -> ~T();
+    T* GetPtr() {
+        return reinterpret_cast<T*>(std::addressof(storage_));
     }
 
-    void IncStrong() override {
-        this->strong_counter_++;
+protected:
+    void DestroyObject() override {
+        GetPtr()->~T();
+    }
+    void Deallocate() override {
+        delete this;
+    }
+
+private:
+    // Padding also rounds the block up to whole lines, so nothing else shares the object's last
+    static constexpr size_t kStorageAlignment =
+        kPadded ? std::max(alignof(T), kCacheLineSize) : alignof(T);
+
+    alignas(kStorageAlignment) std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+};
+
+// A stateless deleter adds nothing but the pointer
+static_assert(sizeof(ControlBlockPtr<int>) == sizeof(ControlBlock) + sizeof(int*));
+
+// Starts the `BackgroundReclaimer` and its thread when a block that needs it is made, where a
+// failure may throw, rather than in the release that first pushes to it
+struct ReclaimerStarted {
+    ReclaimerStarted() {
+        BackgroundReclaimer::Instance();
+    }
+};
+
+// Hands the final destroy-and-free of `Block` to the `BackgroundReclaimer`. The reclaimer comes
+// first among the bases, so it is running before `Block` builds the object
+template <typename Block>
+class ReclaimedBlock : private ReclaimerStarted, public Block {
+public:
+    using Block::Block;
+
+protected:
+    void DestroyObject() override {
+        // Keeps the block alive past the strong owners' `DecWeak` until the reclaimer is done
+        static_cast<ControlBlock*>(*this)->IncWeak();
+        BackgroundReclaimer::Instance().Push(this, &Reclaim);
+    }
+
+private:
+    static void Reclaim(void* self) {
+        auto block = static_cast<ReclaimedBlock*>(self);
+        block->Block::DestroyObject();
+        static_cast<ControlBlock*>(*block)->DecWeak();
     }
-    void DecStrong() override {
-        if (this->strong_counter_ == 1) {
-            reinterpret_cast<T*>(std::addressof(storage_))->~T();
-            if (this->weak_counter_ == 0) {
-                delete this;
-                return;
+};
+
+// The block every factory of a `T` owner allocates: `Block`, or the `ReclaimedBlock` over it if
+// `T`-s are destroyed in the background
+template <typename T, typename Block>
+using BlockFor = std::conditional_t<UseBackgroundReclaim<std::remove_cv_t<T>>::value,
+                                    ReclaimedBlock<Block>, Block>;
+
+template <typename T, typename Block, typename... Args>
+Block* NewBlock(Args&&... args) {
+    return new BlockFor<T, Block>(std::forward<Args>(args)...);
+}
+
+template <typename T, typename Block, typename... Args>
+ControlBlock* NewControlBlock(Args&&... args) {
+    return *NewBlock<T, Block>(std::forward<Args>(args)...);
+}
+
+// Control block of `MakeShared<T[]>`: the elements follow it in the same allocation
+template <typename T>
+class ControlBlockArray : ControlBlock {
+public:
+    static ControlBlockArray* Create(size_t size, bool for_overwrite) {
+        void* raw = ::operator new(GetAllocationSize(size), std::align_val_t(GetAlignment()));
+        auto block = new (raw) ControlBlockArray(size);
+        try {
+            if (for_overwrite) {
+                std::uninitialized_default_construct_n(block->GetPtr(), size);
+            } else {
+                std::uninitialized_value_construct_n(block->GetPtr(), size);
             }
+        } catch (...) {
+            block->~ControlBlockArray();
+            ::operator delete(raw, std::align_val_t(GetAlignment()));
+            throw;
         }
-        this->strong_counter_--;
+        // Only a block that made it is tracked, so the failed one above is never seen
+        block->template Track<T[]>(GetAllocationSize(size));
+        return block;
     }
 
-    int GetStrongCount() override {
-        return this->strong_counter_;
+    operator ControlBlock*() {
+        return this;
     }
 
-    void IncWeak() override {
-        this->weak_counter_++;
+    T* GetPtr() {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + GetOffset());
     }
-    void DecWeak() override {
-        if (this->weak_counter_ == 1 && this->strong_counter_ == 0) {
-            delete this;
-            return;
-        }
-        this->weak_counter_--;
+
+protected:
+    void DestroyObject() override {
+        std::destroy_n(GetPtr(), size_);
+    }
+    void Deallocate() override {
+        this->~ControlBlockArray();
+        ::operator delete(this, std::align_val_t(GetAlignment()));
+    }
+
+private:
+    size_t size_;
+
+    explicit ControlBlockArray(size_t size) : size_(size) {
+    }
+
+    static constexpr size_t GetAlignment() {
+        return std::max(alignof(ControlBlockArray), alignof(T));
+    }
+    static constexpr size_t GetOffset() {
+        return (sizeof(ControlBlockArray) + alignof(T) - 1) / alignof(T) * alignof(T);
+    }
+    static size_t GetAllocationSize(size_t size) {
+        return GetOffset() + size * sizeof(T);
+    }
+};
+
+// `ControlBlockObj` placed and freed through an allocator, stored next to the object
+template <typename T, typename Alloc>
+class ControlBlockAllocObj : ControlBlock {
+public:
+    using ObjectAlloc =
+        typename std::allocator_traits<Alloc>::template rebind_alloc<std::remove_cv_t<T>>;
+    using BlockAlloc =
+        typename std::allocator_traits<Alloc>::template rebind_alloc<ControlBlockAllocObj>;
+
+    template <typename... Args>
+    ControlBlockAllocObj(const Alloc& alloc, Args&&... args) : storage_(ObjectAlloc(alloc)) {
+        std::allocator_traits<ObjectAlloc>::construct(GetAllocator(), GetMutablePtr(),
+                                                      std::forward<Args>(args)...);
+        Track<T>(sizeof(ControlBlockAllocObj), GetPtr());
     }
 
-    int GetWeakCount() override {
-        return this->weak_counter_;
+    operator ControlBlock*() {
+        return this;
     }
 
     T* GetPtr() {
-        return reinterpret_cast<T*>(std::addressof(storage_));
+        return GetMutablePtr();
+    }
+
+protected:
+    void DestroyObject() override {
+        std::allocator_traits<ObjectAlloc>::destroy(GetAllocator(), GetMutablePtr());
+    }
+    void Deallocate() override {
+        BlockAlloc alloc(GetAllocator());
+        this->~ControlBlockAllocObj();
+        std::allocator_traits<BlockAlloc>::deallocate(alloc, this, 1);
     }
 
 private:
-    std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+    using Storage = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+    // An empty allocator takes no space
+    CompressedPair<Storage, ObjectAlloc> storage_;
+
+    std::remove_cv_t<T>* GetMutablePtr() {
+        return reinterpret_cast<std::remove_cv_t<T>*>(std::addressof(storage_.GetFirst()));
+    }
+    ObjectAlloc& GetAllocator() {
+        return storage_.GetSecond();
+    }
 };
 
 template <typename T>
 class SharedPtr {
 public:
+    using ElementType = std::remove_extent_t<T>;
+
     template <typename Y>
     friend class SharedPtr;
 
@@ -192,28 +567,58 @@ public:
         // PutWeakThis();
     }
 
-    explicit SharedPtr(T* ptr) {
-        block_ = *(new ControlBlockPtr<T>(ptr));
+    explicit SharedPtr(ElementType* ptr) {
+        block_ = NewOwningBlock<T>(ptr, Slug<T>());
         observed_ = ptr;
         PutWeakThis();
     }
 
     template <typename U>
     explicit SharedPtr(U* ptr) {
-        block_ = *(new ControlBlockPtr<U>(ptr));
+        block_ = NewOwningBlock<U>(ptr, SlugFor<U>());
+        observed_ = ptr;
+        PutWeakThis();
+    }
+
+    template <typename U, typename Deleter>
+    SharedPtr(U* ptr, Deleter deleter) {
+        block_ = NewOwningBlock<U>(ptr, std::move(deleter));
         observed_ = ptr;
         PutWeakThis();
     }
 
+    // Takes over the deleter as is, without wrapping it
+    template <typename U, typename Deleter>
+    SharedPtr(UniquePtr<U, Deleter>&& other) {
+        if (!other) {
+            return;
+        }
+        block_ = NewControlBlock<U, ControlBlockPtr<U, Deleter>>(other.Get(),
+                                                                 std::move(other.GetDeleter()));
+        observed_ = other.Release();
+        PutWeakThis();
+    }
+
     explicit SharedPtr(const WeakPtr<T>& other) {
-        if (other.Expired()) {
+        if (other.block_ == nullptr || !other.block_->TryIncStrong()) {
             throw BadWeakPtr();
         }
         block_ = other.block_;
         observed_ = other.observed_;
-        if (block_ != nullptr) {
-            block_->IncStrong();
+    }
+
+    // Promote a thread-confined object once it escapes to other threads
+    template <typename Y>
+    explicit SharedPtr(const LocalSharedPtr<Y>& other) {
+        if (other.local_ == nullptr) {
+            return;
+        }
+        if (!other.local_->IsOwnerThread()) {
+            throw BadLocalSharedPtr();
         }
+        block_ = other.local_->GetBlock();
+        observed_ = other.observed_;
+        block_->IncStrong();
     }
 
     template <typename Y>
@@ -226,7 +631,7 @@ public:
     }
 
     template <typename Y>
-    SharedPtr(SharedPtr<Y>&& other) {
+    SharedPtr(SharedPtr<Y>&& other) noexcept {
         block_ = other.block_;
         observed_ = other.observed_;
         other.observed_ = nullptr;
@@ -241,7 +646,7 @@ public:
         }
     }
 
-    SharedPtr(SharedPtr&& other) {
+    SharedPtr(SharedPtr&& other) noexcept {
         block_ = other.block_;
         observed_ = other.observed_;
         other.observed_ = nullptr;
@@ -249,17 +654,29 @@ public:
     }
 
     template <typename Y>
-    SharedPtr(SharedPtr<Y>& other, T* ptr) {
+    SharedPtr(const SharedPtr<Y>& other, ElementType* ptr) {
         block_ = other.block_;
         observed_ = ptr;
-        block_->IncStrong();
+        if (block_ != nullptr) {
+            block_->IncStrong();
+        }
+    }
+
+    // Takes over the reference of `other`, so the counters are left alone
+    template <typename Y>
+    SharedPtr(SharedPtr<Y>&& other, ElementType* ptr) noexcept {
+        block_ = other.block_;
+        observed_ = ptr;
+        other.observed_ = nullptr;
+        other.block_ = nullptr;
     }
 
     // explicit SharedPtr(const WeakPtr<T>& other);
 
     template <typename Y>
     SharedPtr& operator=(const SharedPtr<Y>& other) {
-        if (observed_ == other.observed_) {
+        if (block_ == other.block_) {
+            observed_ = other.observed_;
             return *this;
         }
         Clear();
@@ -272,12 +689,7 @@ public:
     }
 
     template <typename Y>
-    SharedPtr& operator=(SharedPtr<Y>&& other) {
-        if (observed_ == other.observed_) {
-            other.observed_ = nullptr;
-            other.block_ = nullptr;
-            return *this;
-        }
+    SharedPtr& operator=(SharedPtr<Y>&& other) noexcept {
         Clear();
         block_ = other.block_;
         observed_ = other.observed_;
@@ -287,7 +699,8 @@ public:
     }
 
     SharedPtr& operator=(const SharedPtr& other) {
-        if (observed_ == other.observed_) {
+        if (block_ == other.block_) {
+            observed_ = other.observed_;
             return *this;
         }
         Clear();
@@ -299,10 +712,8 @@ public:
         return *this;
     }
 
-    SharedPtr& operator=(SharedPtr&& other) {
-        if (observed_ == other.observed_) {
-            other.observed_ = nullptr;
-            other.block_ = nullptr;
+    SharedPtr& operator=(SharedPtr&& other) noexcept {
+        if (this == &other) {
             return *this;
         }
         Clear();
@@ -317,53 +728,51 @@ public:
         Clear();
     }
 
-    void Reset() {
+    void Reset() noexcept {
         Clear();
         block_ = nullptr;
         observed_ = nullptr;
     }
 
-    void Reset(T* ptr) {
-
+    // The new block is made before the old one is let go, so a failed allocation leaves `*this`
+    // as it was
+    void Reset(ElementType* ptr) {
         if (observed_ == ptr) {
             return;
         }
-        if (observed_ != ptr) {
-            Clear();
-        }
-        block_ = *(new ControlBlockPtr<T>(ptr));
-        observed_ = ptr;
-        PutWeakThis();
+        SharedPtr(ptr).Swap(*this);
     }
 
     template <typename U>
     void Reset(U* ptr) {
-
         if (observed_ == ptr) {
             return;
         }
-        if (observed_ != ptr) {
-            Clear();
-        }
-        block_ = *(new ControlBlockPtr<U>(ptr));
-        observed_ = ptr;
-        PutWeakThis();
+        SharedPtr(ptr).Swap(*this);
     }
 
-    void Swap(SharedPtr& other) {
+    template <typename U, typename Deleter>
+    void Reset(U* ptr, Deleter deleter) {
+        SharedPtr(ptr, std::move(deleter)).Swap(*this);
+    }
+
+    void Swap(SharedPtr& other) noexcept {
         std::swap(block_, other.block_);
         std::swap(observed_, other.observed_);
     }
 
-    T* Get() const {
+    ElementType* Get() const {
         return observed_;
     }
-    T& operator*() const {
+    ElementType& operator*() const {
         return *observed_;
     }
-    T* operator->() const {
+    ElementType* operator->() const {
         return observed_;
     }
+    ElementType& operator[](std::ptrdiff_t i) const {
+        return observed_[i];
+    }
     size_t UseCount() const {
         if (!block_) {
             return 0;
@@ -376,13 +785,30 @@ public:
 
 private:
     ControlBlock* block_ = nullptr;
-    T* observed_ = nullptr;
+    ElementType* observed_ = nullptr;
+
+    // Owned raw pointers of `SharedPtr<T[]>` are released with `delete[]`
+    template <typename U>
+    using SlugFor = std::conditional_t<std::is_array_v<T>, Slug<U[]>, Slug<U>>;
+
+    // Owns `ptr` from the call on: if the block cannot be made, `deleter` frees `ptr` before the
+    // exception leaves, as `std::shared_ptr` does. The block gets a copy, so `deleter` is intact
+    // whichever step throws
+    template <typename Owned, typename U, typename Deleter>
+    static ControlBlock* NewOwningBlock(U* ptr, Deleter deleter) {
+        try {
+            return NewControlBlock<Owned, ControlBlockPtr<U, Deleter>>(ptr, deleter);
+        } catch (...) {
+            deleter(ptr);
+            throw;
+        }
+    }
 
     ControlBlock*& GetBlock() {
         return block_;
     }
     void Clear() {
-        if (block_ != nullptr) {
+        if (block_ != nullptr && !DeferredDecrements<ControlBlock>::Defer(block_)) {
             block_->DecStrong();
         }
     }
@@ -405,10 +831,40 @@ private:
     template <typename Y>
     friend class WeakPtr;
 
+    template <typename Y>
+    friend class LocalSharedPtr;
+
+    template <typename Ptr>
+    friend class AtomicPtr;
+
+    friend class CycleCollector<ControlBlock>;
+
     template <typename U, typename... Args>
     friend SharedPtr<U> MakeShared(Args&&... args);
+
+    template <typename U, typename... Args>
+    friend SharedPtr<U> MakeSharedForOverwrite(Args&&... args);
+
+    template <typename U, typename... Args>
+    friend SharedPtr<U> MakeSharedReclaimed(Args&&... args);
+
+    template <typename U, typename... Args>
+    friend SharedPtr<U> MakeSharedPadded(Args&&... args);
+
+    template <typename U, typename Alloc, typename... Args>
+    friend SharedPtr<U> AllocateShared(const Alloc& alloc, Args&&... args);
 };
 
+static_assert(sizeof(SharedPtr<int>) == 2 * sizeof(void*));
+// Moves only hand the reference over: growing a `std::vector` of them touches no counter
+static_assert(std::is_nothrow_move_constructible_v<SharedPtr<int>> &&
+              std::is_nothrow_move_assignable_v<SharedPtr<int>> &&
+              std::is_nothrow_swappable_v<SharedPtr<int>> &&
+              std::is_nothrow_destructible_v<SharedPtr<int>>);
+
+template <typename T>
+struct IsTriviallyRelocatable<SharedPtr<T>> : std::true_type {};
+
 // template <>
 // inline bool operator==<T>(const SharedPtr& left, const SharedPtr& right) {
 //     return left.observed_ == right.observed_;
@@ -424,16 +880,145 @@ inline bool operator==(const SharedPtr<T>& left, const SharedPtr<U>& right) {
 //     return left.observed_ == right.observed_;
 // }
 
+// `MakeShared<T[]>(n)` / `MakeShared<T[N]>()` value-initialize the elements
 template <typename T, typename... Args>
 SharedPtr<T> MakeShared(Args&&... args) {
     SharedPtr<T> shr;
-    auto cur = (new ControlBlockObj<T>(std::forward<Args>(args)...));
-    shr.block_ = cur;
-    shr.observed_ = (cur->GetPtr());
+    if constexpr (std::is_bounded_array_v<T>) {
+        static_assert(sizeof...(Args) == 0);
+        auto cur = ControlBlockArray<std::remove_extent_t<T>>::Create(std::extent_v<T>, false);
+        shr.block_ = *cur;
+        shr.observed_ = cur->GetPtr();
+    } else if constexpr (std::is_unbounded_array_v<T>) {
+        auto cur = ControlBlockArray<std::remove_extent_t<T>>::Create(args..., false);
+        shr.block_ = *cur;
+        shr.observed_ = cur->GetPtr();
+    } else {
+        auto cur = NewBlock<T, ControlBlockObj<T>>(std::forward<Args>(args)...);
+        shr.block_ = *cur;
+        shr.observed_ = (cur->GetPtr());
+        shr.PutWeakThis();
+    }
+    return shr;
+}
+
+// Same as `MakeShared`, but the object is destroyed on the `BackgroundReclaimer` thread
+template <typename T, typename... Args>
+SharedPtr<T> MakeSharedReclaimed(Args&&... args) {
+    static_assert(!std::is_array_v<T>);
+    SharedPtr<T> shr;
+    auto cur = new ReclaimedBlock<ControlBlockObj<T>>(std::forward<Args>(args)...);
+    shr.block_ = *cur;
+    shr.observed_ = cur->GetPtr();
+    shr.PutWeakThis();
+    return shr;
+}
+
+// Same as `MakeShared`, but the object starts a cache line of its own, away from the counters
+template <typename T, typename... Args>
+SharedPtr<T> MakeSharedPadded(Args&&... args) {
+    static_assert(!std::is_array_v<T>);
+    SharedPtr<T> shr;
+    auto cur = NewBlock<T, ControlBlockObj<T, true>>(std::forward<Args>(args)...);
+    shr.block_ = *cur;
+    shr.observed_ = cur->GetPtr();
     shr.PutWeakThis();
     return shr;
 }
 
+// Same as `MakeShared`, but default-initializes: trivial types are left unset
+template <typename T, typename... Args>
+SharedPtr<T> MakeSharedForOverwrite(Args&&... args) {
+    SharedPtr<T> shr;
+    if constexpr (std::is_bounded_array_v<T>) {
+        static_assert(sizeof...(Args) == 0);
+        auto cur = ControlBlockArray<std::remove_extent_t<T>>::Create(std::extent_v<T>, true);
+        shr.block_ = *cur;
+        shr.observed_ = cur->GetPtr();
+    } else if constexpr (std::is_unbounded_array_v<T>) {
+        auto cur = ControlBlockArray<std::remove_extent_t<T>>::Create(args..., true);
+        shr.block_ = *cur;
+        shr.observed_ = cur->GetPtr();
+    } else {
+        static_assert(sizeof...(Args) == 0);
+        auto cur = NewBlock<T, ControlBlockObj<T>>(ForOverwriteTag{});
+        shr.block_ = *cur;
+        shr.observed_ = cur->GetPtr();
+        shr.PutWeakThis();
+    }
+    return shr;
+}
+
+// `alloc` is a standard allocator or a `std::pmr::memory_resource*`
+template <typename T, typename Alloc, typename... Args>
+SharedPtr<T> AllocateShared(const Alloc& alloc, Args&&... args) {
+    if constexpr (std::is_convertible_v<Alloc, std::pmr::memory_resource*>) {
+        return AllocateShared<T>(std::pmr::polymorphic_allocator<std::byte>(alloc),
+                                 std::forward<Args>(args)...);
+    } else {
+        using Block = BlockFor<T, ControlBlockAllocObj<T, Alloc>>;
+        // Freed through the allocator of the plain block, which a reclaimed one does not outgrow
+        static_assert(sizeof(Block) == sizeof(ControlBlockAllocObj<T, Alloc>));
+        using BlockAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Block>;
+        using Traits = std::allocator_traits<BlockAlloc>;
+        BlockAlloc block_alloc(alloc);
+        Block* cur = Traits::allocate(block_alloc, 1);
+        try {
+            new (cur) Block(alloc, std::forward<Args>(args)...);
+        } catch (...) {
+            Traits::deallocate(block_alloc, cur, 1);
+            throw;
+        }
+        SharedPtr<T> shr;
+        shr.block_ = *cur;
+        shr.observed_ = cur->GetPtr();
+        shr.PutWeakThis();
+        return shr;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pointer casts: the rvalue overloads move the reference over instead of copying it
+
+template <typename T, typename U>
+SharedPtr<T> StaticPointerCast(const SharedPtr<U>& other) {
+    return SharedPtr<T>(other, static_cast<typename SharedPtr<T>::ElementType*>(other.Get()));
+}
+
+template <typename T, typename U>
+SharedPtr<T> StaticPointerCast(SharedPtr<U>&& other) {
+    auto ptr = static_cast<typename SharedPtr<T>::ElementType*>(other.Get());
+    return SharedPtr<T>(std::move(other), ptr);
+}
+
+template <typename T, typename U>
+SharedPtr<T> ConstPointerCast(const SharedPtr<U>& other) {
+    return SharedPtr<T>(other, const_cast<typename SharedPtr<T>::ElementType*>(other.Get()));
+}
+
+template <typename T, typename U>
+SharedPtr<T> ConstPointerCast(SharedPtr<U>&& other) {
+    auto ptr = const_cast<typename SharedPtr<T>::ElementType*>(other.Get());
+    return SharedPtr<T>(std::move(other), ptr);
+}
+
+// On failure the result is empty and `other` keeps its object
+template <typename T, typename U>
+SharedPtr<T> DynamicPointerCast(const SharedPtr<U>& other) {
+    if (auto ptr = dynamic_cast<typename SharedPtr<T>::ElementType*>(other.Get())) {
+        return SharedPtr<T>(other, ptr);
+    }
+    return SharedPtr<T>();
+}
+
+template <typename T, typename U>
+SharedPtr<T> DynamicPointerCast(SharedPtr<U>&& other) {
+    if (auto ptr = dynamic_cast<typename SharedPtr<T>::ElementType*>(other.Get())) {
+        return SharedPtr<T>(std::move(other), ptr);
+    }
+    return SharedPtr<T>();
+}
+
 // Look for usage examples in tests
 class ESFTBase {};
 
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "unique/lifetime.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Opt-in size-class slab allocator for control blocks, cf. tcmalloc / mimalloc.
+//
+// Every thread owns a `SlabCache` with one free list per size class. Blocks are carved out of
+// `kSlabSize`-aligned slabs whose header names the owning cache, so a block freed on another
+// thread is pushed onto the owner's lock-free remote list and reused on its next refill.
+// Caches of finished threads are parked and adopted by new threads; slabs are never released.
+
+#ifndef SLAB_CONTROL_BLOCKS
+#define SLAB_CONTROL_BLOCKS 0
+#endif
+
+// Specialize to place the control blocks of `T` in the slab allocator regardless of the switch
+template <typename T>
+struct UseSlabControlBlock : std::bool_constant<SLAB_CONTROL_BLOCKS> {};
+
+class SlabCache;
+
+struct SlabHeader {
+    SlabCache* owner;
+    size_t size_class;
+};
+
+class SlabCache {
+public:
+    static constexpr size_t kSlabSize = 64 * 1024;
+    static constexpr size_t kGranularity = 16;
+    static constexpr size_t kMaxSize = 512;
+    static constexpr size_t kClassCount = kMaxSize / kGranularity;
+
+    static bool Fits(size_t size, size_t alignment) {
+        return size <= kMaxSize && alignment <= kGranularity;
+    }
+
+    static size_t GetSizeClass(size_t size) {
+        return (size + kGranularity - 1) / kGranularity - 1;
+    }
+
+    static SlabHeader* GetSlab(void* block) {
+        return reinterpret_cast<SlabHeader*>(reinterpret_cast<uintptr_t>(block) &
+                                             ~(kSlabSize - 1));
+    }
+
+    void* Allocate(size_t size_class) {
+        if (free_[size_class] == nullptr) {
+            DrainRemote();
+        }
+        if (FreeBlock* block = free_[size_class]) {
+            free_[size_class] = block->next;
+            return block;
+        }
+        size_t block_size = (size_class + 1) * kGranularity;
+        if (bump_[size_class] == nullptr || bump_[size_class] + block_size > end_[size_class]) {
+            NewSlab(size_class);
+        }
+        void* block = bump_[size_class];
+        bump_[size_class] += block_size;
+        return block;
+    }
+
+    void FreeLocal(void* ptr, size_t size_class) {
+        auto block = static_cast<FreeBlock*>(ptr);
+        block->next = free_[size_class];
+        free_[size_class] = block;
+    }
+
+    void FreeRemote(void* ptr) {
+        auto block = static_cast<FreeBlock*>(ptr);
+        block->next = remote_.load(std::memory_order_relaxed);
+        while (!remote_.compare_exchange_weak(block->next, block, std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+        }
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    static constexpr size_t kHeaderSize =
+        (sizeof(SlabHeader) + kGranularity - 1) / kGranularity * kGranularity;
+
+    FreeBlock* free_[kClassCount] = {};
+    char* bump_[kClassCount] = {};
+    char* end_[kClassCount] = {};
+    std::atomic<FreeBlock*> remote_ = nullptr;
+
+    void DrainRemote() {
+        FreeBlock* block = remote_.exchange(nullptr, std::memory_order_acquire);
+        while (block != nullptr) {
+            FreeBlock* next = block->next;
+            FreeLocal(block, GetSlab(block)->size_class);
+            block = next;
+        }
+    }
+
+    void NewSlab(size_t size_class) {
+        auto slab = static_cast<char*>(::operator new(kSlabSize, std::align_val_t(kSlabSize)));
+        new (slab) SlabHeader{this, size_class};
+        bump_[size_class] = slab + kHeaderSize;
+        end_[size_class] = slab + kSlabSize;
+    }
+};
+
+class SlabAllocator {
+public:
+    static void* Allocate(size_t size) {
+        size_t size_class = SlabCache::GetSizeClass(size);
+        if (SlabCache* cache = LocalCache()) {
+            return cache->Allocate(size_class);
+        }
+        // The thread is past its cache teardown: borrow a cache for this one block
+        SlabCache* cache = Adopt();
+        void* block = cache->Allocate(size_class);
+        Park(cache);
+        return block;
+    }
+
+    static void Deallocate(void* ptr, size_t size) {
+        SlabHeader* slab = SlabCache::GetSlab(ptr);
+        if (slab->owner == LocalCaches::Peek()) {
+            slab->owner->FreeLocal(ptr, SlabCache::GetSizeClass(size));
+        } else {
+            slab->owner->FreeRemote(ptr);
+        }
+    }
+
+private:
+    // A thread adopts a cache on its first allocation and parks it when it exits
+    struct CacheTraits {
+        using Resource = SlabCache;
+
+        static SlabCache* Create() {
+            return Adopt();
+        }
+        static void Destroy(SlabCache* cache) {
+            Park(cache);
+        }
+    };
+    using LocalCaches = ThreadResource<CacheTraits>;
+
+    static SlabCache* LocalCache() {
+        return LocalCaches::Get();
+    }
+
+    static std::mutex& ParkedMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // Parked caches own slabs that may outlive static destructors
+    static std::vector<SlabCache*>& Parked() {
+        return NeverDestroyed<std::vector<SlabCache*>, SlabAllocator>();
+    }
+
+    static SlabCache* Adopt() {
+        std::lock_guard lock(ParkedMutex());
+        if (Parked().empty()) {
+            return new SlabCache();
+        }
+        SlabCache* cache = Parked().back();
+        Parked().pop_back();
+        return cache;
+    }
+
+    static void Park(SlabCache* cache) {
+        std::lock_guard lock(ParkedMutex());
+        Parked().push_back(cache);
+    }
+};
+
+// Mixin giving a control block for `T` class-specific `new` / `delete` through the slab
+// allocator when `UseSlabControlBlock<T>` is set
+template <typename T>
+class SlabAllocated {
+public:
+    static void* operator new(size_t size) {
+        if constexpr (UseSlabControlBlock<T>::value) {
+            if (SlabCache::Fits(size, alignof(T))) {
+                return SlabAllocator::Allocate(size);
+            }
+        }
+        return ::operator new(size);
+    }
+
+    static void operator delete(void* ptr, size_t size) {
+        if constexpr (UseSlabControlBlock<T>::value) {
+            if (SlabCache::Fits(size, alignof(T))) {
+                SlabAllocator::Deallocate(ptr, size);
+                return;
+            }
+        }
+        ::operator delete(ptr);
+    }
+
+    // Blocks of over-aligned or padded objects never fit a slab
+    static void* operator new(size_t size, std::align_val_t alignment) {
+        return ::operator new(size, alignment);
+    }
+
+    static void operator delete(void* ptr, size_t size, std::align_val_t alignment) {
+        ::operator delete(ptr, size, alignment);
+    }
+};
@@ -5,8 +5,14 @@
 // Instead of std::bad_weak_ptr
 class BadWeakPtr : public std::exception {};
 
+// Promoting a `LocalSharedPtr` away from the thread that created it
+class BadLocalSharedPtr : public std::exception {};
+
 template <typename T>
 class SharedPtr;
 
 template <typename T>
 class WeakPtr;
+
+template <typename T>
+class LocalSharedPtr;
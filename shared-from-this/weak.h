@@ -35,7 +35,7 @@ public:
             block_->IncWeak();
         }
     }
-    WeakPtr(WeakPtr&& other) {
+    WeakPtr(WeakPtr&& other) noexcept {
         block_ = other.block_;
         observed_ = other.observed_;
         other.observed_ = nullptr;
@@ -65,7 +65,8 @@ public:
 
     template <typename Y>
     WeakPtr& operator=(const WeakPtr<Y>& other) {
-        if (observed_ == other.observed_) {
+        if (block_ == other.block_) {
+            observed_ = other.observed_;
             return *this;
         }
         Clear();
@@ -78,7 +79,8 @@ public:
     }
 
     WeakPtr& operator=(const WeakPtr& other) {
-        if (observed_ == other.observed_) {
+        if (block_ == other.block_) {
+            observed_ = other.observed_;
             return *this;
         }
         Clear();
@@ -90,10 +92,8 @@ public:
         return *this;
     }
 
-    WeakPtr& operator=(WeakPtr&& other) {
-        if (observed_ == other.observed_) {
-            other.observed_ = nullptr;
-            other.block_ = nullptr;
+    WeakPtr& operator=(WeakPtr&& other) noexcept {
+        if (this == &other) {
             return *this;
         }
         Clear();
@@ -114,12 +114,12 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Modifiers
 
-    void Reset() {
+    void Reset() noexcept {
         Clear();
         block_ = nullptr;
         observed_ = nullptr;
     }
-    void Swap(WeakPtr& other) {
+    void Swap(WeakPtr& other) noexcept {
         std::swap(block_, other.block_);
         std::swap(observed_, other.observed_);
     }
@@ -140,16 +140,17 @@ public:
         return (block_->GetStrongCount() == 0);
     }
     SharedPtr<T> Lock() const {
-        if (!Expired()) {
-            return SharedPtr<T>(*this);
-        } else {
-            return SharedPtr<T>();
+        SharedPtr<T> result;
+        if (block_ != nullptr && block_->TryIncStrong()) {
+            result.block_ = block_;
+            result.observed_ = observed_;
         }
+        return result;
     }
 
 private:
     ControlBlock* block_ = nullptr;
-    T* observed_ = nullptr;
+    std::remove_extent_t<T>* observed_ = nullptr;
     void Clear() {
         if (block_ != nullptr) {
             block_->DecWeak();
@@ -158,6 +159,39 @@ private:
     template <typename Y>
     friend class WeakPtr;
 
+    template <typename Ptr>
+    friend class AtomicPtr;
+
+    template <typename U, typename Y>
+    friend WeakPtr<U> StaticPointerCast(const WeakPtr<Y>& other);
+    template <typename U, typename Y>
+    friend WeakPtr<U> StaticPointerCast(WeakPtr<Y>&& other);
+    template <typename U, typename Y>
+    friend WeakPtr<U> ConstPointerCast(const WeakPtr<Y>& other);
+    template <typename U, typename Y>
+    friend WeakPtr<U> ConstPointerCast(WeakPtr<Y>&& other);
+    template <typename U, typename Y>
+    friend WeakPtr<U> DynamicPointerCast(const WeakPtr<Y>& other);
+    template <typename U, typename Y>
+    friend WeakPtr<U> DynamicPointerCast(WeakPtr<Y>&& other);
+
+    // Aliasing: shares the weak reference of `other`, observes `ptr`
+    template <typename Y>
+    WeakPtr(const WeakPtr<Y>& other, std::remove_extent_t<T>* ptr) {
+        block_ = other.block_;
+        observed_ = ptr;
+        if (block_ != nullptr) {
+            block_->IncWeak();
+        }
+    }
+    template <typename Y>
+    WeakPtr(WeakPtr<Y>&& other, std::remove_extent_t<T>* ptr) noexcept {
+        block_ = other.block_;
+        observed_ = ptr;
+        other.observed_ = nullptr;
+        other.block_ = nullptr;
+    }
+
     // friend class T;
     // template <typename U>
     // friend inline bool operator==(const SharedPtr<T>& left, const SharedPtr<U>& right);
@@ -165,3 +199,56 @@ private:
     // template <typename U, typename... Args>
     // friend SharedPtr<U> MakeShared(Args&&... args);
 };
+
+static_assert(sizeof(WeakPtr<int>) == 2 * sizeof(void*));
+static_assert(std::is_nothrow_move_constructible_v<WeakPtr<int>> &&
+              std::is_nothrow_move_assignable_v<WeakPtr<int>> &&
+              std::is_nothrow_swappable_v<WeakPtr<int>> &&
+              std::is_nothrow_destructible_v<WeakPtr<int>>);
+
+template <typename T>
+struct IsTriviallyRelocatable<WeakPtr<T>> : std::true_type {};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pointer casts: the rvalue overloads move the weak reference over instead of copying it
+
+template <typename T, typename U>
+WeakPtr<T> StaticPointerCast(const WeakPtr<U>& other) {
+    return WeakPtr<T>(other, static_cast<std::remove_extent_t<T>*>(other.observed_));
+}
+
+template <typename T, typename U>
+WeakPtr<T> StaticPointerCast(WeakPtr<U>&& other) {
+    auto ptr = static_cast<std::remove_extent_t<T>*>(other.observed_);
+    return WeakPtr<T>(std::move(other), ptr);
+}
+
+template <typename T, typename U>
+WeakPtr<T> ConstPointerCast(const WeakPtr<U>& other) {
+    return WeakPtr<T>(other, const_cast<std::remove_extent_t<T>*>(other.observed_));
+}
+
+template <typename T, typename U>
+WeakPtr<T> ConstPointerCast(WeakPtr<U>&& other) {
+    auto ptr = const_cast<std::remove_extent_t<T>*>(other.observed_);
+    return WeakPtr<T>(std::move(other), ptr);
+}
+
+// Needs a live object to inspect: an expired `other` gives an empty result
+template <typename T, typename U>
+WeakPtr<T> DynamicPointerCast(const WeakPtr<U>& other) {
+    SharedPtr<U> locked = other.Lock();
+    if (auto ptr = dynamic_cast<std::remove_extent_t<T>*>(locked.Get())) {
+        return WeakPtr<T>(other, ptr);
+    }
+    return WeakPtr<T>();
+}
+
+template <typename T, typename U>
+WeakPtr<T> DynamicPointerCast(WeakPtr<U>&& other) {
+    SharedPtr<U> locked = other.Lock();
+    if (auto ptr = dynamic_cast<std::remove_extent_t<T>*>(locked.Get())) {
+        return WeakPtr<T>(std::move(other), ptr);
+    }
+    return WeakPtr<T>();
+}
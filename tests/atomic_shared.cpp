@@ -0,0 +1,93 @@
+#include "shared-from-this/atomic_shared.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Versioned {
+    static inline std::atomic<int> live = 0;
+
+    int version;
+
+    explicit Versioned(int version) : version(version) {
+        ++live;
+    }
+    ~Versioned() {
+        --live;
+    }
+};
+
+}  // namespace
+
+TEST_CASE("AtomicSharedPtr loads, stores and exchanges") {
+    {
+        AtomicSharedPtr<Versioned> slot;
+        REQUIRE(slot.IsLockFree());
+        REQUIRE(!slot.Load());
+        auto first = MakeShared<Versioned>(1);
+        slot.Store(first);
+        REQUIRE(slot.Load() == first);
+        REQUIRE(first.UseCount() == 2);
+        auto old = slot.Exchange(MakeShared<Versioned>(2));
+        REQUIRE(old == first);
+        REQUIRE(slot.Load()->version == 2);
+        old.Reset();
+        first.Reset();
+        REQUIRE(Versioned::live == 1);
+    }
+    REQUIRE(Versioned::live == 0);
+}
+
+TEST_CASE("AtomicSharedPtr compare-exchange reports the current value") {
+    auto first = MakeShared<Versioned>(1);
+    AtomicSharedPtr<Versioned> slot(first);
+    SharedPtr<Versioned> expected;
+    REQUIRE(!slot.CompareExchange(expected, MakeShared<Versioned>(2)));
+    REQUIRE(expected == first);
+    REQUIRE(slot.CompareExchange(expected, MakeShared<Versioned>(3)));
+    REQUIRE(slot.Load()->version == 3);
+}
+
+TEST_CASE("AtomicWeakPtr does not keep the object alive") {
+    auto object = MakeShared<Versioned>(1);
+    AtomicWeakPtr<Versioned> slot(object);
+    REQUIRE(slot.Load().Lock() == object);
+    object.Reset();
+    REQUIRE(slot.Load().Expired());
+}
+
+TEST_CASE("Readers see whole values while writers replace them") {
+    AtomicSharedPtr<Versioned> slot(MakeShared<Versioned>(0));
+    std::atomic<bool> stop = false;
+    std::atomic<bool> torn = false;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; ++t) {
+        threads.emplace_back([&] {
+            int last = 0;
+            while (!stop.load()) {
+                auto value = slot.Load();
+                // A single writer only ever moves forward
+                if (!value || value->version < last) {
+                    torn = true;
+                }
+                last = value->version;
+            }
+        });
+    }
+    for (int i = 1; i <= 20000; ++i) {
+        slot.Store(MakeShared<Versioned>(i));
+    }
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(!torn);
+    REQUIRE(slot.Load()->version == 20000);
+    // Releases of the readers' last copies may wait for this thread under biased counting
+    FlushBiasedQueue();
+    REQUIRE(Versioned::live == 1);
+}
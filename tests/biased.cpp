@@ -0,0 +1,53 @@
+#include "shared-from-this/weak.h"
+
+#include <catch2/catch.hpp>
+
+#include <thread>
+#include <vector>
+
+static_assert(BIASED_REFCOUNT, "built with biased counting only");
+
+TEST_CASE("Releases handed to the owner count until its queue is drained") {
+    auto object = MakeShared<int>(1);
+    auto copy = object;
+    REQUIRE(object.UseCount() == 2);
+    // The copy was counted by the owner, so the other thread queues its release
+    std::thread([copy = std::move(copy)]() mutable { copy.Reset(); }).join();
+    REQUIRE(object.UseCount() == 2);
+    FlushBiasedQueue();
+    REQUIRE(object.UseCount() == 1);
+}
+
+TEST_CASE("Releases from many threads are queued on the block once") {
+    auto object = MakeShared<int>(3);
+    std::vector<SharedPtr<int>> copies(64, object);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&copies, t] {
+            for (size_t i = t; i < copies.size(); i += 4) {
+                copies[i].Reset();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(object.UseCount() == 65);
+    FlushBiasedQueue();
+    REQUIRE(object.UseCount() == 1);
+}
+
+TEST_CASE("Blocks outlive the thread that created them") {
+    SharedPtr<int> object;
+    WeakPtr<int> weak;
+    std::thread([&] {
+        object = MakeShared<int>(2);
+        weak = object;
+    }).join();
+    REQUIRE(object.UseCount() == 1);
+    auto copy = object;
+    REQUIRE(object.UseCount() == 2);
+    copy.Reset();
+    object.Reset();
+    REQUIRE(weak.Expired());
+}
@@ -0,0 +1,114 @@
+#include "shared-from-this/weak.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static_assert(CYCLE_COLLECTOR, "built with the cycle collector only");
+
+namespace {
+
+struct Node {
+    static inline std::atomic<int> live = 0;
+
+    SharedPtr<Node> next;
+
+    Node() {
+        ++live;
+    }
+    ~Node() {
+        --live;
+    }
+};
+
+// Two nodes pointing at each other, with no other owner left
+void MakeGarbageCycle() {
+    auto a = MakeShared<Node>();
+    auto b = MakeShared<Node>();
+    a->next = b;
+    b->next = a;
+}
+
+void CollectAll() {
+    while (CollectCycles().remaining != 0) {
+    }
+}
+
+}  // namespace
+
+template <>
+struct CycleTrace<Node> : std::true_type {
+    template <typename Visitor>
+    static void Trace(Node& node, Visitor& visit) {
+        visit(node.next);
+    }
+};
+
+TEST_CASE("Unreachable cycles are collected") {
+    CollectAll();
+    for (int i = 0; i < 100; ++i) {
+        MakeGarbageCycle();
+    }
+    REQUIRE(Node::live == 200);
+    CollectAll();
+    REQUIRE(Node::live == 0);
+}
+
+TEST_CASE("Cycles referenced from outside are kept") {
+    CollectAll();
+    auto a = MakeShared<Node>();
+    {
+        auto b = MakeShared<Node>();
+        a->next = b;
+        b->next = a;
+    }
+    CollectAll();
+    REQUIRE(Node::live == 2);
+    REQUIRE(a->next->next == a);
+    a->next.Reset();
+    a.Reset();
+    REQUIRE(Node::live == 0);
+}
+
+TEST_CASE("A collection ends while other threads keep buffering") {
+    CollectAll();
+    std::atomic<bool> stop = false;
+    std::thread churn([&] {
+        while (!stop.load()) {
+            MakeGarbageCycle();
+        }
+    });
+    while (CycleCollector<ControlBlock>::GetCandidateCount() < 1000) {
+        std::this_thread::yield();
+    }
+    // Only the candidates buffered so far bound the call, not the budget
+    CycleStats stats = CollectCycles(std::chrono::hours(1));
+    stop.store(true);
+    churn.join();
+    REQUIRE(stats.roots > 0);
+    CollectAll();
+    REQUIRE(Node::live == 0);
+}
+
+TEST_CASE("Threads buffer candidates concurrently") {
+    CollectAll();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 500; ++i) {
+                MakeGarbageCycle();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // Both nodes of every cycle outlive their last local owner
+    REQUIRE(CycleCollector<ControlBlock>::GetCandidateCount() == 4000);
+    CollectAll();
+    REQUIRE(CycleCollector<ControlBlock>::GetCandidateCount() == 0);
+    REQUIRE(Node::live == 0);
+}
@@ -0,0 +1,82 @@
+#include "shared-from-this/weak.h"
+
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+namespace {
+
+struct Link {
+    static inline int live = 0;
+
+    SharedPtr<Link> next;
+
+    Link() {
+        ++live;
+    }
+    ~Link() {
+        --live;
+    }
+};
+
+SharedPtr<Link> MakeChain(int length) {
+    SharedPtr<Link> head;
+    for (int i = 0; i < length; ++i) {
+        auto link = MakeShared<Link>();
+        link->next = std::move(head);
+        head = std::move(link);
+    }
+    return head;
+}
+
+}  // namespace
+
+TEST_CASE("Deferred releases apply on flush and at the end of the scope") {
+    auto object = MakeShared<int>(1);
+    {
+        DeferredDecrementScope scope;
+        {
+            auto copy = object;
+            auto again = object;
+            REQUIRE(object.UseCount() == 3);
+        }
+        REQUIRE(object.UseCount() == 3);
+        FlushDeferredDecrements();
+        REQUIRE(object.UseCount() == 1);
+        {
+            DeferredDecrementScope nested;
+            auto copy = object;
+        }
+        // Only the outermost scope flushes
+        REQUIRE(object.UseCount() == 2);
+    }
+    REQUIRE(object.UseCount() == 1);
+}
+
+TEST_CASE("A full buffer flushes by itself") {
+    auto object = MakeShared<int>(1);
+    DeferredDecrementScope scope(4);
+    for (int i = 0; i < 3; ++i) {
+        auto copy = object;
+    }
+    REQUIRE(object.UseCount() == 4);
+    {
+        auto copy = object;
+    }
+    REQUIRE(object.UseCount() == 1);
+}
+
+TEST_CASE("Releases from destructors during a flush are not lost") {
+    {
+        DeferredDecrementScope scope(8);
+        // Each flush releases links whose destructors release more than the buffer holds
+        std::vector<SharedPtr<Link>> chains;
+        for (int i = 0; i < 20; ++i) {
+            chains.push_back(MakeChain(50));
+        }
+        chains.clear();
+        FlushDeferredDecrements();
+        REQUIRE(Link::live == 0);
+    }
+    REQUIRE(Link::live == 0);
+}
@@ -0,0 +1,102 @@
+#include "intrusive/hazard.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Guarded : HazardRefCounted<Guarded> {
+    static inline std::atomic<int> live = 0;
+
+    int value;
+
+    explicit Guarded(int value) : value(value) {
+        ++live;
+    }
+    // Readers that reach a destroyed object see a negative value
+    ~Guarded() {
+        value = -1;
+        --live;
+    }
+};
+
+HazardDomain& PrivateDomain() {
+    static HazardDomain domain;
+    return domain;
+}
+
+struct Private : HazardRefCounted<Private, &PrivateDomain> {
+    static inline int live = 0;
+
+    Private() {
+        ++live;
+    }
+    ~Private() {
+        --live;
+    }
+};
+
+void ReclaimAll() {
+    while (HazardDomain::Default().GetRetiredCount() != 0) {
+        HazardDomain::Default().Reclaim();
+    }
+}
+
+}  // namespace
+
+TEST_CASE("Retired objects wait for the hazard pointers naming them") {
+    std::atomic<Guarded*> head = MakeIntrusive<Guarded>(1).Detach();
+    HazardPointer hazard;
+    Guarded* read = hazard.Protect(head);
+    // The owner's reference goes: the object is retired, not freed
+    IntrusivePtr<Guarded>(head.exchange(nullptr), false).Reset();
+    HazardDomain::Default().Reclaim();
+    REQUIRE(Guarded::live == 1);
+    REQUIRE(read->value == 1);
+    hazard.Reset();
+    ReclaimAll();
+    REQUIRE(Guarded::live == 0);
+}
+
+TEST_CASE("Readers never see a freed object while writers replace it") {
+    std::atomic<Guarded*> head = MakeIntrusive<Guarded>(0).Detach();
+    std::atomic<bool> stop = false;
+    std::atomic<bool> freed = false;
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&] {
+            HazardPointer hazard;
+            while (!stop.load()) {
+                Guarded* read = hazard.Protect(head);
+                if (read->value < 0) {
+                    freed = true;
+                }
+            }
+        });
+    }
+    for (int i = 1; i <= 10000; ++i) {
+        Guarded* old = head.exchange(MakeIntrusive<Guarded>(i).Detach());
+        IntrusivePtr<Guarded>(old, false).Reset();
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    IntrusivePtr<Guarded>(head.exchange(nullptr), false).Reset();
+    ReclaimAll();
+    REQUIRE(!freed);
+    REQUIRE(Guarded::live == 0);
+}
+
+TEST_CASE("Objects retire into the domain their type names") {
+    size_t retired = HazardDomain::Default().GetRetiredCount();
+    MakeIntrusive<Private>();
+    REQUIRE(Private::live == 1);
+    REQUIRE(PrivateDomain().GetRetiredCount() == 1);
+    REQUIRE(HazardDomain::Default().GetRetiredCount() == retired);
+    PrivateDomain().Reclaim();
+    REQUIRE(Private::live == 0);
+}
@@ -0,0 +1,164 @@
+#include "intrusive/intrusive.h"
+
+#include <catch2/catch.hpp>
+
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Plain : SimpleRefCounted<Plain> {
+    static inline int live = 0;
+
+    int value;
+
+    explicit Plain(int value = 0) : value(value) {
+        ++live;
+    }
+    ~Plain() {
+        --live;
+    }
+};
+
+struct Allocated : RefCounted<Allocated, SimpleCounter, AllocatedDelete> {
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    std::pmr::string name;
+
+    explicit Allocated(std::string_view name) : name(name) {
+    }
+    Allocated(std::string_view name, const allocator_type& alloc) : name(name, alloc) {
+    }
+};
+
+struct AllocatedBase : RefCounted<AllocatedBase, SimpleCounter, AllocatedDelete> {
+    virtual ~AllocatedBase() = default;
+
+    char tag = 'b';
+};
+
+struct AllocatedBig : AllocatedBase {
+    static inline int live = 0;
+
+    alignas(32) char payload[200] = {};
+
+    AllocatedBig() {
+        ++live;
+    }
+    ~AllocatedBig() override {
+        --live;
+    }
+};
+
+// Allocations taken from it and not yet returned
+class CountingResource : public std::pmr::memory_resource {
+public:
+    std::ptrdiff_t allocated = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        ++allocated;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        --allocated;
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+    bool do_is_equal(const memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+struct Narrow : SizedRefCounted<Narrow, uint16_t> {};
+
+struct Shared : ThreadSafeRefCounted<Shared> {};
+
+}  // namespace
+
+TEST_CASE("IntrusivePtr counts in the object") {
+    {
+        auto a = MakeIntrusive<Plain>(3);
+        REQUIRE(a->RefCount() == 1);
+        auto b = a;
+        REQUIRE(a->RefCount() == 2);
+        IntrusivePtr<Plain> c(std::move(b));
+        REQUIRE(!b);
+        c = std::move(c);
+        REQUIRE(c->RefCount() == 2);
+        c.Swap(b);
+        REQUIRE(!c);
+        REQUIRE(b->value == 3);
+    }
+    REQUIRE(Plain::live == 0);
+}
+
+TEST_CASE("Adopting an uncounted object takes its first reference") {
+    {
+        IntrusivePtr<Plain> adopted(new Plain(1), false);
+        REQUIRE(adopted->RefCount() == 1);
+        auto copy = adopted;
+        REQUIRE(adopted->RefCount() == 2);
+    }
+    REQUIRE(Plain::live == 0);
+}
+
+TEST_CASE("AllocateIntrusive returns the object to its resource") {
+    CountingResource resource;
+    {
+        auto object = AllocateIntrusive<Allocated>(&resource, "a name too long for SSO buffers");
+        REQUIRE(object->name == "a name too long for SSO buffers");
+        // The object and its string both come from the resource
+        REQUIRE(resource.allocated == 2);
+    }
+    REQUIRE(resource.allocated == 0);
+
+    auto std_allocated = AllocateIntrusive<Allocated>(std::allocator<Allocated>(), "x");
+    REQUIRE(std_allocated->RefCount() == 1);
+}
+
+TEST_CASE("AllocateIntrusive of a derived type frees the whole allocation") {
+    CountingResource resource;
+    {
+        IntrusivePtr<AllocatedBase> base = AllocateIntrusive<AllocatedBig>(&resource);
+        REQUIRE(AllocatedBig::live == 1);
+        REQUIRE(reinterpret_cast<uintptr_t>(static_cast<AllocatedBig*>(base.Get())->payload) %
+                    32 ==
+                0);
+    }
+    REQUIRE(AllocatedBig::live == 0);
+    REQUIRE(resource.allocated == 0);
+}
+
+TEST_CASE("Narrow counters throw instead of wrapping") {
+    auto object = MakeIntrusive<Narrow>();
+    std::vector<IntrusivePtr<Narrow>> copies;
+    copies.reserve(70000);
+    REQUIRE_THROWS_AS(
+        [&] {
+            while (true) {
+                copies.push_back(object);
+            }
+        }(),
+        RefCountOverflow);
+    REQUIRE(copies.size() == 65534);
+    copies.clear();
+    REQUIRE(object->RefCount() == 1);
+}
+
+TEST_CASE("ThreadSafeRefCounted may be shared across threads") {
+    auto object = MakeIntrusive<Shared>();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([object] {
+            for (int i = 0; i < 10000; ++i) {
+                IntrusivePtr<Shared> copy(object);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(object->RefCount() == 1);
+}
@@ -0,0 +1,82 @@
+#include "unique/pool.h"
+
+#include <catch2/catch.hpp>
+
+#include <thread>
+
+namespace {
+
+struct Pooled {
+    static inline int live = 0;
+
+    int value;
+
+    explicit Pooled(int value = 0) : value(value) {
+        ++live;
+    }
+    ~Pooled() {
+        --live;
+    }
+};
+
+struct ThrowsOnConstruction {
+    ThrowsOnConstruction() {
+        throw std::runtime_error("construction");
+    }
+};
+
+}  // namespace
+
+TEST_CASE("ObjectPool reuses released slots") {
+    ObjectPool<Pooled> pool(2);
+    Pooled* a = pool.New(1);
+    Pooled* b = pool.New(2);
+    Pooled* c = pool.New(3);
+    pool.Delete(a);
+    pool.Delete(b);
+    pool.Delete(c);
+    REQUIRE(Pooled::live == 0);
+    // Past `max_free` slots go back to `operator delete`
+    REQUIRE(pool.GetFreeCount() == 2);
+    Pooled* d = pool.New(4);
+    REQUIRE((d == a || d == b));
+    REQUIRE(d->value == 4);
+    pool.Delete(d);
+    pool.Trim(0);
+    REQUIRE(pool.GetFreeCount() == 0);
+}
+
+TEST_CASE("A failed construction returns the slot") {
+    ObjectPool<ThrowsOnConstruction> pool;
+    REQUIRE_THROWS_AS(pool.New(), std::runtime_error);
+    REQUIRE(pool.GetFreeCount() == 1);
+}
+
+TEST_CASE("Pooled UniquePtr-s release to their pool") {
+    {
+        auto a = MakeUniqueFromPool(LocalObjectPool<Pooled>(), 5);
+        REQUIRE(a->value == 5);
+        REQUIRE(Pooled::live == 1);
+    }
+    REQUIRE(Pooled::live == 0);
+    REQUIRE(ObjectPool<Pooled>::Local()->GetFreeCount() >= 1);
+
+    ObjectPool<Pooled> pool;
+    {
+        auto b = MakeUniqueFromPool(pool, 6);
+        REQUIRE(b->value == 6);
+    }
+    REQUIRE(pool.GetFreeCount() == 1);
+}
+
+TEST_CASE("Every thread has a pool of its own, torn down when it exits") {
+    ObjectPool<Pooled>* main_pool = ObjectPool<Pooled>::Local();
+    ObjectPool<Pooled>* thread_pool = nullptr;
+    std::thread([&] {
+        thread_pool = ObjectPool<Pooled>::Local();
+        auto object = MakeUniqueFromPool(LocalObjectPool<Pooled>(), 1);
+    }).join();
+    REQUIRE(thread_pool != nullptr);
+    REQUIRE(thread_pool != main_pool);
+    REQUIRE(Pooled::live == 0);
+}
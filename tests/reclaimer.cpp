@@ -0,0 +1,112 @@
+#include "shared-from-this/local.h"
+#include "shared-from-this/weak.h"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace {
+
+struct Background {
+    static inline std::thread::id destroyed_on;
+
+    int value = 0;
+
+    Background() = default;
+    explicit Background(int value) : value(value) {
+    }
+    ~Background() {
+        destroyed_on = std::this_thread::get_id();
+    }
+};
+
+// Holds the reclaimer thread in its destructor until released
+struct Blocking {
+    static inline std::atomic<bool> entered = false;
+    static inline std::atomic<bool> released = false;
+
+    ~Blocking() {
+        entered = true;
+        while (!released) {
+            std::this_thread::yield();
+        }
+    }
+};
+
+struct DrainsOnDestroy {
+    ~DrainsOnDestroy() {
+        BackgroundReclaimer::Instance().Drain();
+    }
+};
+
+}  // namespace
+
+template <>
+struct UseBackgroundReclaim<Background> : std::true_type {};
+
+template <>
+struct UseBackgroundReclaim<Blocking> : std::true_type {};
+
+template <>
+struct UseBackgroundReclaim<DrainsOnDestroy> : std::true_type {};
+
+template <typename Make>
+static bool DestroyedInBackground(Make make) {
+    Background::destroyed_on = std::thread::id();
+    {
+        auto ptr = make();
+        REQUIRE(ptr->value == 0);
+    }
+    BackgroundReclaimer::Instance().Drain();
+    return Background::destroyed_on != std::thread::id() &&
+           Background::destroyed_on != std::this_thread::get_id();
+}
+
+TEST_CASE("Every factory honors UseBackgroundReclaim") {
+    REQUIRE(DestroyedInBackground([] { return MakeShared<Background>(); }));
+    REQUIRE(DestroyedInBackground([] { return SharedPtr<Background>(new Background()); }));
+    REQUIRE(DestroyedInBackground([] { return MakeSharedPadded<Background>(); }));
+    REQUIRE(DestroyedInBackground([] { return MakeSharedForOverwrite<Background>(); }));
+    REQUIRE(DestroyedInBackground(
+        [] { return AllocateShared<Background>(std::allocator<Background>()); }));
+    REQUIRE(DestroyedInBackground([] { return MakeLocalShared<Background>(); }));
+    REQUIRE(DestroyedInBackground([] { return LocalSharedPtr<Background>(new Background()); }));
+}
+
+TEST_CASE("Weak owners keep a reclaimed block alive") {
+    WeakPtr<Background> weak;
+    {
+        auto ptr = MakeShared<Background>(5);
+        weak = ptr;
+    }
+    BackgroundReclaimer::Instance().Drain();
+    REQUIRE(weak.Expired());
+    REQUIRE(!weak.Lock());
+}
+
+TEST_CASE("A full queue reclaims inline") {
+    auto& reclaimer = BackgroundReclaimer::Instance();
+    reclaimer.Drain();
+    reclaimer.SetCapacity(1);
+    size_t overflows = reclaimer.GetStats().overflows;
+    MakeShared<Blocking>();
+    while (!Blocking::entered) {
+        std::this_thread::yield();
+    }
+    // The first one waits in the queue, the second finds it full
+    MakeShared<Background>();
+    Background::destroyed_on = std::thread::id();
+    MakeShared<Background>();
+    REQUIRE(Background::destroyed_on == std::this_thread::get_id());
+    REQUIRE(reclaimer.GetStats().overflows == overflows + 1);
+    Blocking::released = true;
+    reclaimer.Drain();
+    reclaimer.SetCapacity(BackgroundReclaimer::kDefaultCapacity);
+}
+
+TEST_CASE("Draining from the reclaimer thread returns at once") {
+    MakeShared<DrainsOnDestroy>();
+    BackgroundReclaimer::Instance().Drain();
+}
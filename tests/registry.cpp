@@ -0,0 +1,74 @@
+#include "shared-from-this/weak.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <typeinfo>
+
+static_assert(BLOCK_REGISTRY && POINTER_STATS, "built with the registry and statistics only");
+
+namespace {
+
+struct ThrowsOnThird {
+    static inline int built = 0;
+
+    ThrowsOnThird() {
+        if (++built == 3) {
+            throw std::runtime_error("third");
+        }
+    }
+};
+
+struct Tracked {};
+
+size_t CountBlocks(const char* name) {
+    size_t count = 0;
+    BlockRegistry<ControlBlock>::ForEachBlock([&](const BlockInfo& info) {
+        if (std::string(info.name) == name) {
+            ++count;
+        }
+    });
+    return count;
+}
+
+const PointerStats::TypeSnapshot* FindStats(const std::vector<PointerStats::TypeSnapshot>& all,
+                                            const char* name) {
+    for (const auto& snapshot : all) {
+        if (snapshot.name == name) {
+            return &snapshot;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+TEST_CASE("Live blocks are registered until they are freed") {
+    const char* name = typeid(Tracked).name();
+    WeakPtr<Tracked> weak;
+    {
+        auto object = MakeShared<Tracked>();
+        weak = object;
+        REQUIRE(CountBlocks(name) == 1);
+    }
+    // Expired, but kept by the weak owner
+    REQUIRE(CountBlocks(name) == 1);
+    weak.Reset();
+    REQUIRE(CountBlocks(name) == 0);
+}
+
+TEST_CASE("An array that fails to build leaves no block behind") {
+    const char* name = typeid(ThrowsOnThird[]).name();
+    REQUIRE_THROWS_AS(MakeShared<ThrowsOnThird[]>(4), std::runtime_error);
+    REQUIRE(CountBlocks(name) == 0);
+    auto stats = PointerStats::Snapshot();
+    const auto* snapshot = FindStats(stats, name);
+    if (snapshot != nullptr) {
+        REQUIRE(snapshot->events[size_t(StatsEvent::kAllocation)] ==
+                snapshot->events[size_t(StatsEvent::kFree)]);
+    }
+
+    ThrowsOnThird::built = 10;
+    auto array = MakeShared<ThrowsOnThird[]>(2);
+    REQUIRE(CountBlocks(name) == 1);
+}
@@ -0,0 +1,78 @@
+#include "shared-from-this/weak.h"
+#include "unique/relocate.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+namespace {
+
+struct alignas(64) Wide {
+    int value;
+};
+
+}  // namespace
+
+TEST_CASE("RelocatingVector grows without touching the counts") {
+    auto object = MakeShared<int>(1);
+    RelocatingVector<SharedPtr<int>> ptrs;
+    for (int i = 0; i < 100; ++i) {
+        ptrs.PushBack(object);
+    }
+    REQUIRE(ptrs.Size() == 100);
+    REQUIRE(object.UseCount() == 101);
+    ptrs.PopBack();
+    REQUIRE(object.UseCount() == 100);
+    RelocatingVector<SharedPtr<int>> moved(std::move(ptrs));
+    REQUIRE(ptrs.Empty());
+    moved.Clear();
+    REQUIRE(object.UseCount() == 1);
+}
+
+TEST_CASE("RelocatingVector may push its own elements while growing") {
+    RelocatingVector<SharedPtr<int>> ptrs;
+    ptrs.PushBack(MakeShared<int>(7));
+    RelocatingVector<std::string> strings;
+    strings.PushBack(std::string(100, 'x'));
+    RelocatingVector<Wide> wide;
+    wide.PushBack(Wide{3});
+    for (int i = 0; i < 64; ++i) {
+        ptrs.PushBack(ptrs[0]);
+        strings.PushBack(strings[0]);
+        wide.PushBack(wide[0]);
+    }
+    REQUIRE(*ptrs[64] == 7);
+    REQUIRE(ptrs[0].UseCount() == 65);
+    REQUIRE(strings[64] == std::string(100, 'x'));
+    REQUIRE(wide[64].value == 3);
+    REQUIRE(reinterpret_cast<uintptr_t>(wide.Data()) % alignof(Wide) == 0);
+}
+
+TEST_CASE("RelocatingHashMap inserts, finds and erases") {
+    RelocatingHashMap<int, SharedPtr<int>> map;
+    for (int i = 0; i < 1000; ++i) {
+        REQUIRE(map.Emplace(i, MakeShared<int>(i)).second);
+    }
+    REQUIRE(!map.Emplace(5, nullptr).second);
+    for (int i = 0; i < 1000; i += 2) {
+        REQUIRE(map.Erase(i));
+    }
+    REQUIRE(!map.Erase(0));
+    REQUIRE(map.Size() == 500);
+    for (int i = 0; i < 1000; ++i) {
+        SharedPtr<int>* value = map.Find(i);
+        REQUIRE((value != nullptr) == (i % 2 == 1));
+        if (value != nullptr) {
+            REQUIRE(**value == i);
+        }
+    }
+}
+
+TEST_CASE("RelocatingHashMap may insert its own values while rehashing") {
+    RelocatingHashMap<int, std::string> map;
+    map.Emplace(0, std::string(100, 'y'));
+    for (int i = 1; i < 100; ++i) {
+        map.Emplace(i, *map.Find(0));
+    }
+    REQUIRE(*map.Find(99) == std::string(100, 'y'));
+}
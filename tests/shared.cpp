@@ -0,0 +1,225 @@
+#include "shared-from-this/local.h"
+#include "shared-from-this/weak.h"
+
+#include <catch2/catch.hpp>
+
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Counted {
+    static inline int live = 0;
+
+    int value;
+
+    explicit Counted(int value = 0) : value(value) {
+        ++live;
+    }
+    ~Counted() {
+        --live;
+    }
+};
+
+struct Base {
+    virtual ~Base() = default;
+};
+
+struct Derived : Base {
+    int value = 7;
+};
+
+struct Node : EnableSharedFromThis<Node> {
+    int value = 3;
+};
+
+// The blocks of an `Unallocatable` come from its allocation mixin below, which fails on demand
+struct Unallocatable : Counted {
+    using Counted::Counted;
+};
+
+}  // namespace
+
+template <>
+class SlabAllocated<Unallocatable> {
+public:
+    // Set right before a call to make its next block allocation fail
+    static inline bool fail_next = false;
+
+    static void* operator new(size_t size) {
+        if (std::exchange(fail_next, false)) {
+            throw std::bad_alloc();
+        }
+        return ::operator new(size);
+    }
+    static void operator delete(void* ptr) {
+        ::operator delete(ptr);
+    }
+};
+
+TEST_CASE("MakeShared counts owners") {
+    {
+        auto a = MakeShared<Counted>(5);
+        REQUIRE(a->value == 5);
+        REQUIRE(a.UseCount() == 1);
+        auto b = a;
+        REQUIRE(a.UseCount() == 2);
+        auto c = std::move(b);
+        REQUIRE(!b);
+        REQUIRE(c.UseCount() == 2);
+        c.Reset();
+        REQUIRE(a.UseCount() == 1);
+    }
+    REQUIRE(Counted::live == 0);
+}
+
+TEST_CASE("Raw pointers and custom deleters") {
+    int deleted = 0;
+    {
+        SharedPtr<Counted> a(new Counted(1));
+        SharedPtr<Counted> b(new Counted(2), [&](Counted* ptr) {
+            ++deleted;
+            delete ptr;
+        });
+        REQUIRE(Counted::live == 2);
+        a = b;
+        REQUIRE(Counted::live == 1);
+        REQUIRE(b.UseCount() == 2);
+    }
+    REQUIRE(deleted == 1);
+    REQUIRE(Counted::live == 0);
+}
+
+TEST_CASE("A block that cannot be allocated frees the pointer") {
+    int deleted = 0;
+    auto deleter = [&](Unallocatable* ptr) {
+        ++deleted;
+        delete ptr;
+    };
+    auto attempt = [&](auto&& call) {
+        bool threw = false;
+        try {
+            SlabAllocated<Unallocatable>::fail_next = true;
+            call();
+        } catch (const std::bad_alloc&) {
+            threw = true;
+        }
+        REQUIRE(threw);
+    };
+    {
+        auto* ptr = new Unallocatable(1);
+        attempt([&] { SharedPtr<Unallocatable> a(ptr, deleter); });
+        REQUIRE(deleted == 1);
+        REQUIRE(Counted::live == 0);
+    }
+    {
+        SharedPtr<Unallocatable> a(new Unallocatable(1));
+        auto* ptr = new Unallocatable(2);
+        attempt([&] { a.Reset(ptr, deleter); });
+        REQUIRE(deleted == 2);
+        REQUIRE(a->value == 1);
+        REQUIRE(a.UseCount() == 1);
+        ptr = new Unallocatable(3);
+        attempt([&] { a.Reset(ptr); });
+        REQUIRE(a->value == 1);
+    }
+    REQUIRE(Counted::live == 0);
+}
+
+TEST_CASE("Assignment to the same object keeps the count") {
+    auto a = MakeShared<Counted>(1);
+    auto b = a;
+    b = a;
+    REQUIRE(a.UseCount() == 2);
+    b = std::move(a);
+    REQUIRE(b.UseCount() == 1);
+    auto& self = b;
+    b = std::move(self);
+    REQUIRE(b.UseCount() == 1);
+    REQUIRE(b->value == 1);
+}
+
+TEST_CASE("WeakPtr locks while the object lives") {
+    WeakPtr<Counted> weak;
+    REQUIRE(weak.Expired());
+    REQUIRE(!weak.Lock());
+    {
+        auto strong = MakeShared<Counted>(4);
+        weak = strong;
+        REQUIRE(!weak.Expired());
+        REQUIRE(weak.Lock()->value == 4);
+        REQUIRE(strong.UseCount() == 1);
+    }
+    REQUIRE(Counted::live == 0);
+    REQUIRE(weak.Expired());
+    REQUIRE(!weak.Lock());
+    REQUIRE_THROWS_AS(SharedPtr<Counted>(weak), BadWeakPtr);
+}
+
+TEST_CASE("SharedFromThis shares the owner") {
+    auto node = MakeShared<Node>();
+    SharedPtr<Node> self = node->SharedFromThis();
+    REQUIRE(self == node);
+    REQUIRE(node.UseCount() == 2);
+    REQUIRE(node->WeakFromThis().Lock() == node);
+}
+
+TEST_CASE("Arrays are value-initialized in one allocation") {
+    auto array = MakeShared<int[]>(16);
+    for (int i = 0; i < 16; ++i) {
+        REQUIRE(array[i] == 0);
+    }
+    auto objects = MakeShared<Counted[3]>();
+    REQUIRE(Counted::live == 3);
+    objects.Reset();
+    REQUIRE(Counted::live == 0);
+}
+
+TEST_CASE("Pointer casts share the block") {
+    SharedPtr<Base> base = MakeShared<Derived>();
+    auto derived = DynamicPointerCast<Derived>(base);
+    REQUIRE(derived->value == 7);
+    REQUIRE(base.UseCount() == 2);
+    auto moved = StaticPointerCast<Derived>(std::move(base));
+    REQUIRE(!base);
+    REQUIRE(moved.UseCount() == 2);
+    REQUIRE(!DynamicPointerCast<Node>(SharedPtr<Base>(MakeShared<Base>())));
+}
+
+TEST_CASE("LocalSharedPtr promotes on its own thread only") {
+    auto local = MakeLocalShared<Counted>(2);
+    auto copy = local;
+    REQUIRE(local.UseCount() == 2);
+    SharedPtr<Counted> shared(local);
+    REQUIRE(shared->value == 2);
+    bool thrown = false;
+    std::thread([&] {
+        try {
+            SharedPtr<Counted> elsewhere(local);
+        } catch (const BadLocalSharedPtr&) {
+            thrown = true;
+        }
+    }).join();
+    REQUIRE(thrown);
+}
+
+TEST_CASE("Copies may be dropped on other threads") {
+    auto object = MakeShared<Counted>(1);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([copy = object]() mutable {
+            for (int i = 0; i < 1000; ++i) {
+                auto again = copy;
+            }
+            copy.Reset();
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    FlushBiasedQueue();
+    REQUIRE(object.UseCount() == 1);
+}
@@ -58,13 +58,17 @@ class CompressedPair<F, S, std::enable_if_t<!comp_is_compressed_v<F> && comp_is_
 public:
     CompressedPair() {
     }
-    CompressedPair(const F& first, const S& second) : first_(first) {
+    CompressedPair(const F& first, const S& second) : S(second), first_(first) {
     }
 
-    CompressedPair(F&& first, const S&& second) : first_(std::move(first)) {
+    CompressedPair(F&& first, const S&& second) : S(second), first_(std::move(first)) {
     }
 
-    CompressedPair(F&& first, const S& second) : first_(std::move(first)) {
+    CompressedPair(F&& first, const S& second) : S(second), first_(std::move(first)) {
+    }
+
+    // `first` is left default-initialized
+    CompressedPair(const S& second) : S(second) {
     }
 
     CompressedPair(const F& first) : first_(first) {
@@ -172,6 +176,10 @@ public:
     CompressedPair(F& first, S&& second) : first_(first), second_(std::move(second)) {
     }
 
+    // `first` is left default-initialized
+    CompressedPair(const S& second) : second_(second) {
+    }
+
     ~CompressedPair() {
     }
 
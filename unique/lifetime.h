@@ -0,0 +1,65 @@
+#pragma once
+
+// Lifetimes of the process- and thread-wide state behind the allocators and registries: pointers
+// may be released from static destructors and from other thread-local destructors, so that
+// state must outlive both.
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Never destroyed
+
+// The `T` of `Owner`, built on first use and leaked at exit. `Owner` keeps apart singletons of
+// the same type that belong to different classes.
+template <typename T, typename Owner>
+T& NeverDestroyed() {
+    static auto object = new T();
+    return *object;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Per-thread resources
+
+// One `Traits::Resource` per thread, made by `Traits::Create()` on the thread's first `Get()` and
+// handed to `Traits::Destroy(resource)` when it exits. From then on `Get()` returns `nullptr`,
+// and callers fall back to some shared path.
+template <typename Traits>
+class ThreadResource {
+public:
+    using Resource = typename Traits::Resource;
+
+    static Resource* Get() {
+        State& state = GetState();
+        if (state.resource == nullptr && !state.exited) {
+            static thread_local Guard guard;
+            state.resource = Traits::Create();
+        }
+        return state.resource;
+    }
+
+    // The resource if the thread has one, without creating it
+    static Resource* Peek() {
+        return GetState().resource;
+    }
+
+private:
+    // Trivially destructible, so it stays usable from other thread-local destructors
+    struct State {
+        Resource* resource = nullptr;
+        bool exited = false;
+    };
+
+    struct Guard {
+        ~Guard() {
+            State& state = GetState();
+            if (state.resource != nullptr) {
+                Traits::Destroy(state.resource);
+            }
+            state.resource = nullptr;
+            state.exited = true;
+        }
+    };
+
+    static State& GetState() {
+        static thread_local State state;
+        return state;
+    }
+};
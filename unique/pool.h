@@ -0,0 +1,177 @@
+#pragma once
+
+#include "lifetime.h"
+#include "unique.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Object pools for `UniquePtr`: a released object is destroyed, but its slot goes on a free list
+// and the next `New` of the same type constructs in it instead of calling `operator new`.
+//
+// A pool is not thread-safe. `ObjectPool<T>::Local()` is the calling thread's own pool, and
+// `PoolDeleter<T>` releases to it without storing anything, so `UniquePtr<T, PoolDeleter<T>>`
+// stays one pointer wide. All slots of `T` share one size and alignment, so an object may be
+// released to another pool of its type than the one it came from, e.g. on another thread.
+
+template <typename T>
+class ObjectPool {
+public:
+    // Releases beyond this many free slots go back to `operator delete`
+    static constexpr size_t kDefaultMaxFree = 1024;
+
+    explicit ObjectPool(size_t max_free = kDefaultMaxFree) : max_free_(max_free) {
+    }
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    ~ObjectPool() {
+        Trim(0);
+    }
+
+    template <typename... Args>
+    T* New(Args&&... args) {
+        void* slot;
+        if (free_ != nullptr) {
+            slot = free_;
+            free_ = free_->next;
+            --free_count_;
+        } else {
+            slot = ::operator new(kSlotSize, kSlotAlignment);
+        }
+        try {
+            return new (slot) T(std::forward<Args>(args)...);
+        } catch (...) {
+            Recycle(slot);
+            throw;
+        }
+    }
+
+    void Delete(T* object) {
+        object->~T();
+        Recycle(object);
+    }
+
+    // Frees slots until at most `max_free` are left
+    void Trim(size_t max_free) {
+        while (free_count_ > max_free) {
+            FreeSlot* slot = free_;
+            free_ = slot->next;
+            --free_count_;
+            ::operator delete(slot, kSlotSize, kSlotAlignment);
+        }
+    }
+
+    size_t GetFreeCount() const {
+        return free_count_;
+    }
+
+    // The calling thread's pool; `nullptr` once the thread is past its teardown
+    static ObjectPool* Local() {
+        return LocalPools::Get();
+    }
+
+private:
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    static constexpr size_t kSlotSize = std::max(sizeof(T), sizeof(FreeSlot));
+    static constexpr std::align_val_t kSlotAlignment{std::max(alignof(T), alignof(FreeSlot))};
+
+    FreeSlot* free_ = nullptr;
+    size_t free_count_ = 0;
+    size_t max_free_;
+
+    void Recycle(void* slot) {
+        if (free_count_ >= max_free_) {
+            ::operator delete(slot, kSlotSize, kSlotAlignment);
+            return;
+        }
+        free_ = new (slot) FreeSlot{free_};
+        ++free_count_;
+    }
+
+    struct PoolTraits {
+        using Resource = ObjectPool;
+
+        static ObjectPool* Create() {
+            return new ObjectPool();
+        }
+        static void Destroy(ObjectPool* pool) {
+            delete pool;
+        }
+    };
+    using LocalPools = ThreadResource<PoolTraits>;
+};
+
+// Empty handle on the calling thread's pool
+template <typename T>
+class LocalObjectPool {
+public:
+    template <typename... Args>
+    T* New(Args&&... args) const {
+        if (ObjectPool<T>* pool = ObjectPool<T>::Local()) {
+            return pool->New(std::forward<Args>(args)...);
+        }
+        // The thread is past its pool teardown: go through a pool that keeps nothing
+        ObjectPool<T> pool(0);
+        return pool.New(std::forward<Args>(args)...);
+    }
+
+    void Delete(T* object) const {
+        if (ObjectPool<T>* pool = ObjectPool<T>::Local()) {
+            pool->Delete(object);
+            return;
+        }
+        ObjectPool<T> pool(0);
+        pool.Delete(object);
+    }
+};
+
+// Deleter of `MakeUniqueFromPool`. `Pool` is either `LocalObjectPool<T>`, which takes no room,
+// or an `ObjectPool<T>*`.
+template <typename T, typename Pool = LocalObjectPool<T>>
+class PoolDeleter {
+public:
+    PoolDeleter() {
+    }
+    PoolDeleter(Pool pool) : pool_(pool) {
+    }
+
+    void operator()(T*& a) {
+        if (a == nullptr) {
+            return;
+        }
+        if constexpr (std::is_pointer_v<Pool>) {
+            pool_->Delete(a);
+        } else {
+            pool_.Delete(a);
+        }
+    }
+
+    const Pool& GetPool() const {
+        return pool_;
+    }
+
+private:
+    [[no_unique_address]] Pool pool_{};
+};
+
+static_assert(sizeof(UniquePtr<int, PoolDeleter<int>>) == sizeof(void*));
+
+template <typename T, typename... Args>
+UniquePtr<T, PoolDeleter<T>> MakeUniqueFromPool(LocalObjectPool<T> pool, Args&&... args) {
+    return UniquePtr<T, PoolDeleter<T>>(pool.New(std::forward<Args>(args)...), pool);
+}
+
+// `pool` must outlive the pointer
+template <typename T, typename... Args>
+UniquePtr<T, PoolDeleter<T, ObjectPool<T>*>> MakeUniqueFromPool(ObjectPool<T>& pool,
+                                                               Args&&... args) {
+    return UniquePtr<T, PoolDeleter<T, ObjectPool<T>*>>(pool.New(std::forward<Args>(args)...),
+                                                       &pool);
+}
@@ -0,0 +1,434 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+
+// Trivial relocation: moving an object to a new address and ending its life at the old one in
+// a single `memcpy`, cf. P1144 and folly's `IsRelocatable`. The smart pointers only hold
+// addresses of other objects, never of themselves, so their containers can grow by copying
+// bytes, with no refcount traffic and no destructor calls.
+
+// Specialize as `std::true_type` for types that may be relocated with `memcpy`
+template <typename T>
+struct IsTriviallyRelocatable : std::is_trivially_copyable<T> {};
+
+template <typename T>
+struct IsTriviallyRelocatable<std::allocator<T>> : std::true_type {};
+
+template <typename T>
+struct IsTriviallyRelocatable<std::pmr::polymorphic_allocator<T>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool kIsTriviallyRelocatable = IsTriviallyRelocatable<std::remove_cv_t<T>>::value;
+
+// Moves `count` objects from `from` to the uninitialized `to` and ends their life at `from`.
+// The ranges must not overlap.
+template <typename T>
+void RelocateN(T* from, size_t count, T* to) {
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        if (count != 0) {
+            std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), count * sizeof(T));
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            new (to + i) T(std::move(from[i]));
+            from[i].~T();
+        }
+    }
+}
+
+// Raw storage for the containers below: `malloc` whenever the alignment allows, so that
+// relocatable elements can grow in place with `realloc`
+template <typename T>
+class RelocatingStorage {
+public:
+    static constexpr bool kUsesMalloc = alignof(T) <= alignof(std::max_align_t);
+    // `Reallocate` may free the old block before anything else can be placed in the new one
+    static constexpr bool kGrowsInPlace = kUsesMalloc && kIsTriviallyRelocatable<T>;
+
+    static T* Allocate(size_t count) {
+        if constexpr (kUsesMalloc) {
+            void* data = std::malloc(count * sizeof(T));
+            if (data == nullptr) {
+                throw std::bad_alloc();
+            }
+            return static_cast<T*>(data);
+        } else {
+            return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignof(T))));
+        }
+    }
+
+    static void Deallocate(T* data) {
+        if constexpr (kUsesMalloc) {
+            std::free(data);
+        } else {
+            ::operator delete(data, std::align_val_t(alignof(T)));
+        }
+    }
+
+    // Moves the first `size` objects to a block of `capacity` and frees the old one
+    static T* Reallocate(T* data, size_t size, size_t capacity) {
+        if constexpr (kGrowsInPlace) {
+            void* grown = std::realloc(static_cast<void*>(data), capacity * sizeof(T));
+            if (grown == nullptr) {
+                throw std::bad_alloc();
+            }
+            return static_cast<T*>(grown);
+        } else {
+            T* grown = Allocate(capacity);
+            RelocateN(data, size, grown);
+            Deallocate(data);
+            return grown;
+        }
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Vector
+
+// Growable array that relocates its elements instead of moving them one by one. Not copyable;
+// a move constructor that throws while growing loses the elements.
+template <typename T>
+class RelocatingVector {
+public:
+    RelocatingVector() {
+    }
+    RelocatingVector(RelocatingVector&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          capacity_(std::exchange(other.capacity_, 0)) {
+    }
+    RelocatingVector& operator=(RelocatingVector&& other) noexcept {
+        if (this != &other) {
+            Release();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            capacity_ = std::exchange(other.capacity_, 0);
+        }
+        return *this;
+    }
+    RelocatingVector(const RelocatingVector&) = delete;
+    RelocatingVector& operator=(const RelocatingVector&) = delete;
+
+    ~RelocatingVector() {
+        Release();
+    }
+
+    template <typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        if (size_ == capacity_) {
+            return GrowAndEmplaceBack(std::forward<Args>(args)...);
+        }
+        T* object = new (data_ + size_) T(std::forward<Args>(args)...);
+        ++size_;
+        return *object;
+    }
+    void PushBack(const T& value) {
+        EmplaceBack(value);
+    }
+    void PushBack(T&& value) {
+        EmplaceBack(std::move(value));
+    }
+    void PopBack() {
+        data_[--size_].~T();
+    }
+
+    void Reserve(size_t capacity) {
+        if (capacity > capacity_) {
+            data_ = Storage::Reallocate(data_, size_, capacity);
+            capacity_ = capacity;
+        }
+    }
+    void Clear() {
+        std::destroy_n(data_, size_);
+        size_ = 0;
+    }
+
+    T& operator[](size_t i) {
+        return data_[i];
+    }
+    const T& operator[](size_t i) const {
+        return data_[i];
+    }
+    T* Data() {
+        return data_;
+    }
+    size_t Size() const {
+        return size_;
+    }
+    size_t Capacity() const {
+        return capacity_;
+    }
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    T* begin() {
+        return data_;
+    }
+    T* end() {
+        return data_ + size_;
+    }
+    const T* begin() const {
+        return data_;
+    }
+    const T* end() const {
+        return data_ + size_;
+    }
+
+private:
+    using Storage = RelocatingStorage<T>;
+    static constexpr size_t kMinCapacity = 4;
+
+    T* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+
+    void Release() {
+        Clear();
+        Storage::Deallocate(data_);
+        data_ = nullptr;
+        capacity_ = 0;
+    }
+
+    // `args` may refer to elements, as in `v.PushBack(v[0])`: the new element is built before
+    // the old buffer goes away
+    template <typename... Args>
+    T& GrowAndEmplaceBack(Args&&... args) {
+        size_t capacity = capacity_ == 0 ? kMinCapacity : capacity_ * 2;
+        if constexpr (Storage::kGrowsInPlace) {
+            alignas(T) unsigned char aside[sizeof(T)];
+            T* object = new (aside) T(std::forward<Args>(args)...);
+            try {
+                Reserve(capacity);
+            } catch (...) {
+                object->~T();
+                throw;
+            }
+            RelocateN(object, 1, data_ + size_);
+        } else {
+            T* grown = Storage::Allocate(capacity);
+            try {
+                new (grown + size_) T(std::forward<Args>(args)...);
+            } catch (...) {
+                Storage::Deallocate(grown);
+                throw;
+            }
+            RelocateN(data_, size_, grown);
+            Storage::Deallocate(data_);
+            data_ = grown;
+            capacity_ = capacity;
+        }
+        return data_[size_++];
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Hash map
+
+template <typename Key, typename Value>
+struct HashMapEntry {
+    Key key;
+    Value value;
+};
+
+template <typename Key, typename Value>
+struct IsTriviallyRelocatable<HashMapEntry<Key, Value>>
+    : std::bool_constant<kIsTriviallyRelocatable<Key> && kIsTriviallyRelocatable<Value>> {};
+
+// Open-addressing hash map with linear probing and backward-shift erasure: both rehashing and
+// erasure relocate entries. Pointers to values are invalidated by any insertion or erasure.
+template <typename Key, typename Value, typename Hash = std::hash<Key>,
+          typename Equal = std::equal_to<Key>>
+class RelocatingHashMap {
+public:
+    using Entry = HashMapEntry<Key, Value>;
+
+    RelocatingHashMap() {
+    }
+    RelocatingHashMap(const RelocatingHashMap&) = delete;
+    RelocatingHashMap& operator=(const RelocatingHashMap&) = delete;
+
+    ~RelocatingHashMap() {
+        Clear();
+        EntryStorage::Deallocate(entries_);
+        std::free(used_);
+    }
+
+    Value* Find(const Key& key) {
+        size_t slot = FindSlot(key);
+        return slot == capacity_ ? nullptr : &entries_[slot].value;
+    }
+
+    // The value stays as it was if `key` is already there; the flag tells whether it was added
+    template <typename... Args>
+    std::pair<Value*, bool> Emplace(const Key& key, Args&&... args) {
+        if ((size_ + 1) * kMaxLoadDen > capacity_ * kMaxLoadNum) {
+            return GrowAndEmplace(key, std::forward<Args>(args)...);
+        }
+        size_t slot = Home(key);
+        for (; used_[slot]; slot = Next(slot)) {
+            if (Equal()(entries_[slot].key, key)) {
+                return {&entries_[slot].value, false};
+            }
+        }
+        new (entries_ + slot) Entry{key, Value(std::forward<Args>(args)...)};
+        used_[slot] = true;
+        ++size_;
+        return {&entries_[slot].value, true};
+    }
+
+    bool Erase(const Key& key) {
+        size_t hole = FindSlot(key);
+        if (hole == capacity_) {
+            return false;
+        }
+        entries_[hole].~Entry();
+        // Pull back every later entry of the run that may live in the hole
+        for (size_t slot = Next(hole); used_[slot]; slot = Next(slot)) {
+            size_t home = Home(entries_[slot].key);
+            if (((slot - home) & Mask()) >= ((slot - hole) & Mask())) {
+                RelocateN(entries_ + slot, 1, entries_ + hole);
+                hole = slot;
+            }
+        }
+        used_[hole] = false;
+        --size_;
+        return true;
+    }
+
+    template <typename Visitor>
+    void ForEach(Visitor&& visit) {
+        for (size_t slot = 0; slot < capacity_; ++slot) {
+            if (used_[slot]) {
+                visit(entries_[slot].key, entries_[slot].value);
+            }
+        }
+    }
+
+    void Reserve(size_t size) {
+        size_t capacity = capacity_ == 0 ? kMinCapacity : capacity_;
+        while (size * kMaxLoadDen > capacity * kMaxLoadNum) {
+            capacity *= 2;
+        }
+        if (capacity > capacity_) {
+            Rehash(capacity);
+        }
+    }
+
+    void Clear() {
+        for (size_t slot = 0; slot < capacity_; ++slot) {
+            if (used_[slot]) {
+                entries_[slot].~Entry();
+                used_[slot] = false;
+            }
+        }
+        size_ = 0;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+    size_t Capacity() const {
+        return capacity_;
+    }
+
+private:
+    using EntryStorage = RelocatingStorage<Entry>;
+
+    static constexpr size_t kMinCapacity = 8;
+    static constexpr size_t kMaxLoadNum = 3;
+    static constexpr size_t kMaxLoadDen = 4;
+
+    Entry* entries_ = nullptr;
+    bool* used_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+    int shift_ = 64;
+
+    size_t Mask() const {
+        return capacity_ - 1;
+    }
+    size_t Next(size_t slot) const {
+        return (slot + 1) & Mask();
+    }
+    // `capacity_` if `key` is not there
+    size_t FindSlot(const Key& key) const {
+        if (size_ == 0) {
+            return capacity_;
+        }
+        for (size_t slot = Home(key);; slot = Next(slot)) {
+            if (!used_[slot]) {
+                return capacity_;
+            }
+            if (Equal()(entries_[slot].key, key)) {
+                return slot;
+            }
+        }
+    }
+
+    // Fibonacci hashing spreads keys such as aligned addresses whose low bits are all zero
+    size_t Home(const Key& key) const {
+        return static_cast<size_t>((uint64_t(Hash()(key)) * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    // `key` and `args` may refer to entries, so the new one is built before the rehash moves them
+    template <typename... Args>
+    std::pair<Value*, bool> GrowAndEmplace(const Key& key, Args&&... args) {
+        if (size_t slot = FindSlot(key); slot != capacity_) {
+            return {&entries_[slot].value, false};
+        }
+        alignas(Entry) unsigned char aside[sizeof(Entry)];
+        Entry* entry = new (aside) Entry{key, Value(std::forward<Args>(args)...)};
+        try {
+            Rehash(capacity_ == 0 ? kMinCapacity : capacity_ * 2);
+        } catch (...) {
+            entry->~Entry();
+            throw;
+        }
+        size_t slot = Home(entry->key);
+        while (used_[slot]) {
+            slot = Next(slot);
+        }
+        RelocateN(entry, 1, entries_ + slot);
+        used_[slot] = true;
+        ++size_;
+        return {&entries_[slot].value, true};
+    }
+
+    void Rehash(size_t capacity) {
+        Entry* entries = EntryStorage::Allocate(capacity);
+        auto used = static_cast<bool*>(std::calloc(capacity, sizeof(bool)));
+        if (used == nullptr) {
+            EntryStorage::Deallocate(entries);
+            throw std::bad_alloc();
+        }
+        std::swap(entries, entries_);
+        std::swap(used, used_);
+        size_t old_capacity = std::exchange(capacity_, capacity);
+        shift_ = 64;
+        for (size_t bits = capacity; bits > 1; bits >>= 1) {
+            --shift_;
+        }
+        for (size_t slot = 0; slot < old_capacity; ++slot) {
+            if (used[slot]) {
+                size_t target = Home(entries[slot].key);
+                while (used_[target]) {
+                    target = Next(target);
+                }
+                RelocateN(entries + slot, 1, entries_ + target);
+                used_[target] = true;
+            }
+        }
+        EntryStorage::Deallocate(entries);
+        std::free(used);
+    }
+};
@@ -0,0 +1,276 @@
+#pragma once
+
+#include "lifetime.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+// Opt-in per-type statistics for the ownership types: allocations and frees, strong and weak
+// increments and decrements, peak strong count and a log2 histogram of object lifetimes.
+//
+// Every thread accumulates into its own counters, which only that thread writes; `Snapshot()`
+// and `Dump()` sum them from any thread. Counters of finished threads are folded into a shared
+// total. Without `POINTER_STATS` the hooks are empty and `StatsTag` takes no space.
+
+#ifndef POINTER_STATS
+#define POINTER_STATS 0
+#endif
+
+enum class StatsEvent { kAllocation, kFree, kStrongInc, kStrongDec, kWeakInc, kWeakDec };
+
+class PointerStats {
+public:
+    static constexpr size_t kEventCount = 6;
+    // Types past the limit are reported together under the last slot
+    static constexpr size_t kMaxTypes = 128;
+    // Bucket `i` counts lifetimes in [2^i, 2^(i + 1)) ns; the last one is open-ended
+    static constexpr size_t kLifetimeBuckets = 32;
+
+    struct TypeSnapshot {
+        std::string name;
+        uint64_t events[kEventCount] = {};
+        uint64_t peak_use = 0;
+        uint64_t lifetime[kLifetimeBuckets] = {};
+    };
+
+    template <typename T>
+    static size_t TypeIndex() {
+        static const size_t index = Register(typeid(T).name());
+        return index;
+    }
+
+    static void Record(size_t type, StatsEvent event, uint64_t count = 1) {
+        Add(&Counters::events, type, static_cast<size_t>(event), count);
+    }
+
+    static void RecordUse(size_t type, uint64_t use) {
+        Counters* local = Local();
+        std::atomic<uint64_t>& peak = (local ? *local : Retired()).peak[type];
+        if (use > peak.load(std::memory_order_relaxed)) {
+            peak.store(use, std::memory_order_relaxed);
+        }
+    }
+
+    static void RecordLifetime(size_t type, uint64_t born) {
+        uint64_t lifetime = Now() - born;
+        size_t bucket = 0;
+        while (lifetime > 1 && bucket + 1 < kLifetimeBuckets) {
+            lifetime >>= 1;
+            ++bucket;
+        }
+        Add(&Counters::lifetime, type, bucket, 1);
+    }
+
+    static uint64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // Totals over all threads, one entry per type seen so far
+    static std::vector<TypeSnapshot> Snapshot() {
+        std::lock_guard lock(Mutex());
+        std::vector<TypeSnapshot> result(Names().size());
+        for (size_t type = 0; type < result.size(); ++type) {
+            result[type].name = Names()[type];
+        }
+        Accumulate(Retired(), result);
+        for (Counters* counters : Threads()) {
+            Accumulate(*counters, result);
+        }
+        return result;
+    }
+
+    // One line per type: name, event counts, peak use and the non-empty lifetime buckets
+    static void Dump(std::ostream& out) {
+        static const char* const kEventNames[kEventCount] = {
+            "alloc", "free", "strong_inc", "strong_dec", "weak_inc", "weak_dec"};
+        for (const TypeSnapshot& type : Snapshot()) {
+            out << type.name;
+            for (size_t event = 0; event < kEventCount; ++event) {
+                out << ' ' << kEventNames[event] << '=' << type.events[event];
+            }
+            out << " peak_use=" << type.peak_use << " lifetime_log2_ns=";
+            for (size_t bucket = 0; bucket < kLifetimeBuckets; ++bucket) {
+                if (type.lifetime[bucket] != 0) {
+                    out << bucket << ':' << type.lifetime[bucket] << ',';
+                }
+            }
+            out << '\n';
+        }
+    }
+
+private:
+    struct Counters {
+        std::atomic<uint64_t> events[kMaxTypes][kEventCount] = {};
+        std::atomic<uint64_t> peak[kMaxTypes] = {};
+        std::atomic<uint64_t> lifetime[kMaxTypes][kLifetimeBuckets] = {};
+    };
+
+    // Folds the counters into `Retired()` when the thread exits
+    struct CountersTraits {
+        using Resource = Counters;
+
+        static Counters* Create() {
+            auto counters = new Counters();
+            std::lock_guard lock(Mutex());
+            Threads().push_back(counters);
+            return counters;
+        }
+        static void Destroy(Counters* counters) {
+            std::lock_guard lock(Mutex());
+            Merge(*counters, Retired());
+            std::erase(Threads(), counters);
+            delete counters;
+        }
+    };
+
+    // Null once the thread is past its teardown
+    static Counters* Local() {
+        return ThreadResource<CountersTraits>::Get();
+    }
+
+    template <size_t kWidth>
+    static void Add(std::atomic<uint64_t> (Counters::*table)[kMaxTypes][kWidth], size_t type,
+                    size_t index, uint64_t count) {
+        if (Counters* local = Local()) {
+            // Only the owning thread writes, so a plain load and store are enough
+            std::atomic<uint64_t>& counter = (local->*table)[type][index];
+            counter.store(counter.load(std::memory_order_relaxed) + count,
+                          std::memory_order_relaxed);
+        } else {
+            (Retired().*table)[type][index].fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+
+    static std::mutex& Mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // Hooks may fire from static destructors
+    static std::vector<std::string>& Names() {
+        return NeverDestroyed<std::vector<std::string>, PointerStats>();
+    }
+
+    static std::vector<Counters*>& Threads() {
+        return NeverDestroyed<std::vector<Counters*>, PointerStats>();
+    }
+
+    static Counters& Retired() {
+        return NeverDestroyed<Counters, PointerStats>();
+    }
+
+    static size_t Register(const char* name) {
+        std::lock_guard lock(Mutex());
+        if (Names().size() + 1 == kMaxTypes) {
+            Names().push_back("(other)");
+        }
+        if (Names().size() == kMaxTypes) {
+            return kMaxTypes - 1;
+        }
+        Names().push_back(name);
+        return Names().size() - 1;
+    }
+
+    static void Merge(const Counters& from, Counters& to) {
+        for (size_t type = 0; type < kMaxTypes; ++type) {
+            for (size_t event = 0; event < kEventCount; ++event) {
+                to.events[type][event].fetch_add(
+                    from.events[type][event].load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+            }
+            uint64_t peak = from.peak[type].load(std::memory_order_relaxed);
+            if (peak > to.peak[type].load(std::memory_order_relaxed)) {
+                to.peak[type].store(peak, std::memory_order_relaxed);
+            }
+            for (size_t bucket = 0; bucket < kLifetimeBuckets; ++bucket) {
+                to.lifetime[type][bucket].fetch_add(
+                    from.lifetime[type][bucket].load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+            }
+        }
+    }
+
+    static void Accumulate(const Counters& from, std::vector<TypeSnapshot>& to) {
+        for (size_t type = 0; type < to.size(); ++type) {
+            for (size_t event = 0; event < kEventCount; ++event) {
+                to[type].events[event] += from.events[type][event].load(std::memory_order_relaxed);
+            }
+            to[type].peak_use =
+                std::max(to[type].peak_use, from.peak[type].load(std::memory_order_relaxed));
+            for (size_t bucket = 0; bucket < kLifetimeBuckets; ++bucket) {
+                to[type].lifetime[bucket] +=
+                    from.lifetime[type][bucket].load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+// Records `event` for `T`; compiled out without `POINTER_STATS`
+template <typename T>
+inline void CountEvent([[maybe_unused]] StatsEvent event) {
+#if POINTER_STATS
+    PointerStats::Record(PointerStats::TypeIndex<T>(), event);
+#endif
+}
+
+// Per-object part of the statistics, for owners that erase the object type
+class StatsTag {
+public:
+#if POINTER_STATS
+    template <typename T>
+    void Track() {
+        type_ = PointerStats::TypeIndex<T>();
+        born_ = PointerStats::Now();
+        PointerStats::Record(type_, StatsEvent::kAllocation);
+    }
+    void Count(StatsEvent event, uint64_t count = 1) const {
+        PointerStats::Record(type_, event, count);
+    }
+    void Use(uint64_t use) const {
+        PointerStats::RecordUse(type_, use);
+    }
+    void Die() const {
+        PointerStats::RecordLifetime(type_, born_);
+    }
+
+private:
+    // Blocks that never call `Track` land in the overflow slot
+    uint32_t type_ = PointerStats::kMaxTypes - 1;
+    uint64_t born_ = 0;
+#else
+    template <typename T>
+    void Track() {
+    }
+    void Count(StatsEvent, uint64_t = 1) const {
+    }
+    void Use(uint64_t) const {
+    }
+    void Die() const {
+    }
+#endif
+};
+
+// `StatsTag` that tracks itself as `T` whenever the owning object is constructed or copied
+template <typename T>
+class SelfTrackedStatsTag : public StatsTag {
+public:
+    SelfTrackedStatsTag() {
+        Track<T>();
+    }
+    SelfTrackedStatsTag(const SelfTrackedStatsTag&) : StatsTag() {
+        Track<T>();
+    }
+    SelfTrackedStatsTag& operator=(const SelfTrackedStatsTag&) {
+        return *this;
+    }
+};
@@ -1,8 +1,16 @@
 #pragma once
 
 #include "compressed_pair.h"
+#include "relocate.h"
+#include "stats.h"
 
+#include <algorithm>
 #include <cstddef>  // std::nullptr_t
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <memory_resource>
+#include <new>
 #include <type_traits>
 
 template <class T, class U>
@@ -74,6 +82,71 @@ struct Slug<T[]> {
     }
 };
 
+// Deleter of `AllocateUnique`: returns the object to the allocator it came from. Deriving from
+// the allocator keeps `UniquePtr` one pointer wide for empty allocators.
+template <class Alloc>
+class AllocatorDelete : Alloc {
+public:
+    using Traits = std::allocator_traits<Alloc>;
+
+    AllocatorDelete() {
+    }
+    AllocatorDelete(const Alloc& alloc) : Alloc(alloc) {
+    }
+
+    void operator()(typename Traits::value_type*& a) {
+        if (a == nullptr) {
+            return;
+        }
+        Alloc& alloc = *this;
+        Traits::destroy(alloc, a);
+        Traits::deallocate(alloc, a, 1);
+    }
+
+    const Alloc& GetAllocator() const {
+        return *this;
+    }
+};
+
+// Deleter of the aligned array forms of `MakeUnique`: destroys `count` elements and frees them
+// with the alignment they were allocated with
+template <class T>
+class AlignedArrayDelete {
+public:
+    AlignedArrayDelete() {
+    }
+    AlignedArrayDelete(size_t count, size_t alignment) : count_(count), alignment_(alignment) {
+    }
+
+    void operator()(T*& a) {
+        if (a == nullptr) {
+            return;
+        }
+        std::destroy_n(a, count_);
+        ::operator delete(static_cast<void*>(a), std::align_val_t(alignment_));
+    }
+
+    size_t GetCount() const {
+        return count_;
+    }
+    size_t GetAlignment() const {
+        return alignment_;
+    }
+
+private:
+    size_t count_ = 0;
+    size_t alignment_ = alignof(T);
+};
+
+// An alignment that is not a power of two
+class BadAlignment : public std::exception {};
+
+template <class T>
+struct IsTriviallyRelocatable<Slug<T>> : std::true_type {};
+
+template <class Alloc>
+struct IsTriviallyRelocatable<AllocatorDelete<Alloc>> : IsTriviallyRelocatable<Alloc> {};
+
 // Primary template
 template <typename T, typename Deleter = Slug<T>>
 class UniquePtr {
@@ -82,14 +155,15 @@ public:
     // Constructors
 
     explicit UniquePtr(T* ptr = nullptr) : object_(ptr, Deleter()) {
+        Count(ptr, StatsEvent::kAllocation);
     }
     UniquePtr(T* ptr, Deleter deleter) : object_(ptr, std::move(deleter)) {
+        Count(ptr, StatsEvent::kAllocation);
     }
 
     template <class U, class DeleterU>
-    UniquePtr(UniquePtr<U, DeleterU>&& other) noexcept {
-        object_.GetFirst() = std::move(other.object_.GetFirst());
-        object_.GetSecond() = std::move(other.object_.GetSecond());
+    UniquePtr(UniquePtr<U, DeleterU>&& other) noexcept
+        : object_(other.object_.GetFirst(), std::move(other.object_.GetSecond())) {
         other.object_.GetFirst() = nullptr;
     }
 
@@ -105,7 +179,7 @@ public:
         return *this;
     }
 
-    UniquePtr& operator=(std::nullptr_t) {
+    UniquePtr& operator=(std::nullptr_t) noexcept {
         Clear();
         return *this;
     }
@@ -114,19 +188,21 @@ public:
         Clear();
     }
 
-    T* Release() {
+    T* Release() noexcept {
         auto first = object_.GetFirst();
         object_.GetFirst() = nullptr;
         return first;
     }
 
-    void Reset(T* ptr = nullptr) {
+    void Reset(T* ptr = nullptr) noexcept {
         auto prev = object_.GetFirst();
         object_.GetFirst() = ptr;
+        Count(ptr, StatsEvent::kAllocation);
+        Count(prev, StatsEvent::kFree);
         object_.GetSecond()(prev);
     }
 
-    void Swap(UniquePtr& other) {
+    void Swap(UniquePtr& other) noexcept {
         std::swap(object_.GetFirst(), other.object_.GetFirst());
         std::swap(object_.GetSecond(), other.object_.GetSecond());
     }
@@ -159,9 +235,16 @@ public:
 
 private:
     void Clear() {
+        Count(object_.GetFirst(), StatsEvent::kFree);
         object_.GetSecond()(object_.GetFirst());
         object_.GetFirst() = nullptr;
     }
+
+    static void Count(T* ptr, StatsEvent event) {
+        if (ptr != nullptr) {
+            CountEvent<T>(event);
+        }
+    }
 };
 
 // Specialization for arrays
@@ -169,13 +252,14 @@ template <typename T, typename Deleter>
 class UniquePtr<T[], Deleter> {
 public:
     explicit UniquePtr(T* ptr = nullptr) : object_(ptr, Deleter()) {
+        Count(ptr, StatsEvent::kAllocation);
     }
     UniquePtr(T* ptr, Deleter deleter) : object_(ptr, deleter) {
+        Count(ptr, StatsEvent::kAllocation);
     }
 
-    UniquePtr(UniquePtr&& other) noexcept {
-        object_.GetFirst() = dynamic_cast<T*>(std::move(other.object_.GetFirst()));
-        object_.GetSecond() = std::move(other.object_.GetSecond());
+    UniquePtr(UniquePtr&& other) noexcept
+        : object_(other.object_.GetFirst(), std::move(other.object_.GetSecond())) {
         other.object_.GetFirst() = nullptr;
     }
 
@@ -188,7 +272,7 @@ public:
         other.object_.GetFirst() = nullptr;
         return *this;
     }
-    UniquePtr& operator=(std::nullptr_t) {
+    UniquePtr& operator=(std::nullptr_t) noexcept {
         Clear();
         return *this;
     }
@@ -197,19 +281,21 @@ public:
         Clear();
     }
 
-    T* Release() {
+    T* Release() noexcept {
         auto first = object_.GetFirst();
         object_.GetFirst() = nullptr;
         return first;
     }
 
-    void Reset(T* ptr = nullptr) {
+    void Reset(T* ptr = nullptr) noexcept {
         auto prev = object_.GetFirst();
         object_.GetFirst() = ptr;
+        Count(ptr, StatsEvent::kAllocation);
+        Count(prev, StatsEvent::kFree);
         object_.GetSecond()(prev);
     }
 
-    void Swap(UniquePtr& other) {
+    void Swap(UniquePtr& other) noexcept {
         std::swap(object_.GetFirst(), other.object_.GetFirst());
         std::swap(object_.GetSecond(), other.object_.GetSecond());
     }
@@ -244,6 +330,108 @@ public:
 private:
     CompressedPair<T*, Deleter> object_;
     void Clear() {
+        Count(object_.GetFirst(), StatsEvent::kFree);
         object_.GetSecond()(object_.GetFirst());
+        object_.GetFirst() = nullptr;
+    }
+
+    static void Count(T* ptr, StatsEvent event) {
+        if (ptr != nullptr) {
+            CountEvent<T[]>(event);
+        }
     }
-};
\ No newline at end of file
+};
+
+// Moving never touches the counters or the heap, so containers may rely on it
+static_assert(std::is_nothrow_move_constructible_v<UniquePtr<int>> &&
+              std::is_nothrow_move_assignable_v<UniquePtr<int>> &&
+              std::is_nothrow_swappable_v<UniquePtr<int>>);
+static_assert(std::is_nothrow_move_constructible_v<UniquePtr<int[]>> &&
+              std::is_nothrow_move_assignable_v<UniquePtr<int[]>> &&
+              std::is_nothrow_swappable_v<UniquePtr<int[]>>);
+
+// As relocatable as the deleter
+template <typename T, typename Deleter>
+struct IsTriviallyRelocatable<UniquePtr<T, Deleter>> : IsTriviallyRelocatable<Deleter> {};
+
+// `alloc` is a standard allocator or a `std::pmr::memory_resource*`
+template <typename T, typename Alloc, typename... Args>
+auto AllocateUnique(const Alloc& alloc, Args&&... args) {
+    if constexpr (std::is_convertible_v<Alloc, std::pmr::memory_resource*>) {
+        return AllocateUnique<T>(std::pmr::polymorphic_allocator<T>(alloc),
+                                 std::forward<Args>(args)...);
+    } else {
+        using ObjectAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+        using Traits = std::allocator_traits<ObjectAlloc>;
+        ObjectAlloc object_alloc(alloc);
+        T* object = Traits::allocate(object_alloc, 1);
+        try {
+            Traits::construct(object_alloc, object, std::forward<Args>(args)...);
+        } catch (...) {
+            Traits::deallocate(object_alloc, object, 1);
+            throw;
+        }
+        return UniquePtr<T, AllocatorDelete<ObjectAlloc>>(object, object_alloc);
+    }
+}
+
+template <typename T, typename... Args>
+UniquePtr<T> MakeUnique(Args&&... args) requires(!std::is_array_v<T>) {
+    return UniquePtr<T>(new T(std::forward<Args>(args)...));
+}
+
+// Elements are value-initialized, i.e. zeroed for scalars
+template <typename T>
+UniquePtr<T> MakeUnique(size_t count) requires std::is_unbounded_array_v<T> {
+    return UniquePtr<T>(new std::remove_extent_t<T>[count]());
+}
+
+// Default-initialized: scalars and trivial types are left indeterminate, for buffers that are
+// about to be overwritten anyway
+template <typename T>
+UniquePtr<T> MakeUniqueForOverwrite() requires(!std::is_array_v<T>) {
+    return UniquePtr<T>(new T);
+}
+
+template <typename T>
+UniquePtr<T> MakeUniqueForOverwrite(size_t count) requires std::is_unbounded_array_v<T> {
+    return UniquePtr<T>(new std::remove_extent_t<T>[count]);
+}
+
+// Storage for `count` elements aligned to `alignment` bytes, or to the element's own alignment
+// if that is stricter. Throws `BadAlignment` unless `alignment` is a power of two.
+template <typename T, bool kValueInit>
+UniquePtr<T[], AlignedArrayDelete<T>> MakeAlignedArray(size_t count, size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        throw BadAlignment();
+    }
+    if (count > SIZE_MAX / sizeof(T)) {
+        throw std::bad_array_new_length();
+    }
+    alignment = std::max(alignment, alignof(T));
+    auto data = static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignment)));
+    try {
+        if constexpr (kValueInit) {
+            std::uninitialized_value_construct_n(data, count);
+        } else {
+            std::uninitialized_default_construct_n(data, count);
+        }
+    } catch (...) {
+        ::operator delete(static_cast<void*>(data), std::align_val_t(alignment));
+        throw;
+    }
+    return UniquePtr<T[], AlignedArrayDelete<T>>(data, AlignedArrayDelete<T>(count, alignment));
+}
+
+// E.g. `MakeUnique<float[]>(n, 64)` for buffers read with aligned SIMD loads
+template <typename T>
+UniquePtr<T, AlignedArrayDelete<std::remove_extent_t<T>>> MakeUnique(
+    size_t count, size_t alignment) requires std::is_unbounded_array_v<T> {
+    return MakeAlignedArray<std::remove_extent_t<T>, true>(count, alignment);
+}
+
+template <typename T>
+UniquePtr<T, AlignedArrayDelete<std::remove_extent_t<T>>> MakeUniqueForOverwrite(
+    size_t count, size_t alignment) requires std::is_unbounded_array_v<T> {
+    return MakeAlignedArray<std::remove_extent_t<T>, false>(count, alignment);
+}
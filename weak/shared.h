@@ -1,7 +1,9 @@
 #pragma once
 
 #include "sw_fwd.h"  // Forward declaration
+#include "unique/unique.h"
 
+#include <atomic>
 #include <cstddef>  // std::nullptr_t
 #include <iostream>
 #include <type_traits>
@@ -9,152 +11,117 @@
 
 // https://en.cppreference.com/w/cpp/memory/shared_ptr
 
+// Counting is non-virtual; only destroying the object and freeing the block are type-erased
 class ControlBlock {
 public:
-    // ControlBlock() {}
-    virtual void IncStrong() {
+    void IncStrong() {
+        strong_counter_.fetch_add(1, std::memory_order_relaxed);
+    }
+    void DecStrong() {
+        if (strong_counter_.fetch_sub(1, std::memory_order_release) == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            DestroyObject();
+            DecWeak();
+        }
     }
 
-    virtual void DecStrong() {
+    int GetStrongCount() const {
+        return strong_counter_.load(std::memory_order_relaxed);
     }
 
-    virtual int GetStrongCount() {
-        return 0;
+    // Takes a strong reference unless the object is already gone; used to promote weak owners
+    bool TryIncStrong() {
+        int count = strong_counter_.load(std::memory_order_relaxed);
+        while (count != 0) {
+            if (strong_counter_.compare_exchange_weak(count, count + 1, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
     }
 
-    virtual void IncWeak(){};
-
-    virtual void DecWeak(){};
+    void IncWeak() {
+        weak_counter_.fetch_add(1, std::memory_order_relaxed);
+    }
+    void DecWeak() {
+        // A count of one means we hold the last reference: nobody can observe the block
+        // anymore, so skip the read-modify-write.
+        if (weak_counter_.load(std::memory_order_acquire) == 1 ||
+            weak_counter_.fetch_sub(1, std::memory_order_release) == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            Deallocate();
+        }
+    }
 
-    virtual int GetWeakCount() {
-        return 0;
-    };
+    int GetWeakCount() const {
+        return weak_counter_.load(std::memory_order_relaxed) - (GetStrongCount() != 0);
+    }
 
-    // virtual auto GetPtr() {}
     virtual ~ControlBlock() noexcept {
     }
 
+protected:
+    virtual void DestroyObject() = 0;
+    virtual void Deallocate() = 0;
+
 private:
-    int strong_counter_ = 0;
-    int weak_counter_ = 0;
-    template <typename T>
-    friend class ControlBlockPtr;
-    template <typename T>
-    friend class ControlBlockObj;
-    // friend class ControlBlockPtr;
-    // friend class ControlBlockObj;
+    // Blocks are born with one strong owner. Strong owners together hold one extra weak
+    // reference, so whoever drops `weak_counter_` to zero frees the block.
+    std::atomic<int> strong_counter_ = 1;
+    std::atomic<int> weak_counter_ = 1;
 };
 
-template <typename T>
+template <typename T, typename Deleter = Slug<T>>
 class ControlBlockPtr : ControlBlock {
 public:
-    ControlBlockPtr(T* ptr = nullptr) : ptr_(ptr) {
-        this->IncStrong();
-    }
-
-    void IncStrong() override {
-        this->strong_counter_++;
+    ControlBlockPtr(T* ptr = nullptr) : object_(ptr, Deleter()) {
     }
-    void DecStrong() override {
-        this->strong_counter_--;
-        if (this->strong_counter_ == 0) {
-            if (this->weak_counter_ == 0) {
-                delete this;
-            } else {
-                delete ptr_;
-                ptr_ = nullptr;
-            }
-        }
-    }
-
-    int GetStrongCount() override {
-        return this->strong_counter_;
-    }
-
-    void IncWeak() override {
-        this->weak_counter_++;
-    }
-    void DecWeak() override {
-        this->weak_counter_--;
-        if (this->weak_counter_ == 0 && this->strong_counter_ == 0) {
-            delete this;
-        }
-    }
-
-    int GetWeakCount() override {
-        return this->weak_counter_;
+    ControlBlockPtr(T* ptr, Deleter deleter) : object_(ptr, std::move(deleter)) {
     }
 
     operator ControlBlock*() {
         return this;
     }
 
-    ~ControlBlockPtr() override {
-        delete ptr_;
+protected:
+    void DestroyObject() override {
+        object_.GetSecond()(object_.GetFirst());
+        object_.GetFirst() = nullptr;
+    }
+    void Deallocate() override {
+        delete this;
     }
 
 private:
-    T* ptr_;
+    // A stateless deleter takes no space
+    CompressedPair<T*, Deleter> object_;
 };
 
 template <typename T>
 class ControlBlockObj : ControlBlock {
 public:
-    // ControlBlockObj(T& obj) : obj_(obj) {
-    //     this->IncStrong();
-    // }
-    // template <typename Y>
-
     template <typename U, typename... Args>
     friend SharedPtr<U> MakeShared(Args&&... args);
 
     template <typename... Args>
     ControlBlockObj(Args&&... args) {
-        new (GetPtr()) T(std::forward<Args>(args)...);
-        this->IncStrong();
+        new (std::addressof(storage_)) T(std::forward<Args>(args)...);
     }
 
     operator ControlBlock*() {
         return this;
     }
 
-    ~ControlBlockObj() override {
-        // reinterpret_cast<T*>(std::addressof(storage_)) -> ~T();
-    }
-
-    void IncStrong() override {
-        this->strong_counter_++;
-    }
-    void DecStrong() override {
-        this->strong_counter_--;
-        if (this->strong_counter_ == 0) {
-            reinterpret_cast<T*>(std::addressof(storage_))->~T();
-            if (this->weak_counter_ == 0) {
-                delete this;
-            }
-        }
-    }
-
-    int GetStrongCount() override {
-        return this->strong_counter_;
+    T* GetPtr() {
+        return reinterpret_cast<T*>(std::addressof(storage_));
     }
 
-    void IncWeak() override {
-        this->weak_counter_++;
-    }
-    void DecWeak() override {
-        this->weak_counter_--;
-        if (this->weak_counter_ == 0 && this->strong_counter_ == 0) {
-            delete this;
-        }
+protected:
+    void DestroyObject() override {
+        GetPtr()->~T();
     }
-
-    int GetWeakCount() override {
-        return this->weak_counter_;
-    }
-
-    T* GetPtr() {
-        return reinterpret_cast<T*>(std::addressof(storage_));
+    void Deallocate() override {
+        delete this;
     }
 
 private:
@@ -176,25 +143,38 @@ public:
     }
 
     explicit SharedPtr(T* ptr) {
-        block_ = *(new ControlBlockPtr<T>(ptr));
+        block_ = NewOwningBlock(ptr, Slug<T>());
         observed_ = ptr;
     }
 
     template <typename U>
     explicit SharedPtr(U* ptr) {
-        block_ = *(new ControlBlockPtr<U>(ptr));
+        block_ = NewOwningBlock(ptr, Slug<U>());
+        observed_ = ptr;
+    }
+
+    template <typename U, typename Deleter>
+    SharedPtr(U* ptr, Deleter deleter) {
+        block_ = NewOwningBlock(ptr, std::move(deleter));
         observed_ = ptr;
     }
 
+    // Takes over the deleter as is, without wrapping it
+    template <typename U, typename Deleter>
+    SharedPtr(UniquePtr<U, Deleter>&& other) {
+        if (!other) {
+            return;
+        }
+        block_ = *(new ControlBlockPtr<U, Deleter>(other.Get(), std::move(other.GetDeleter())));
+        observed_ = other.Release();
+    }
+
     explicit SharedPtr(const WeakPtr<T>& other) {
-        if (other.Expired()) {
+        if (other.block_ == nullptr || !other.block_->TryIncStrong()) {
             throw BadWeakPtr();
         }
         block_ = other.block_;
         observed_ = other.observed_;
-        if (block_ != nullptr) {
-            block_->IncStrong();
-        }
     }
 
     template <typename Y>
@@ -304,29 +284,26 @@ public:
         observed_ = nullptr;
     }
 
+    // The new block is made before the old one is let go, so a failed allocation leaves `*this`
+    // as it was
     void Reset(T* ptr) {
-
         if (observed_ == ptr) {
             return;
         }
-        if (observed_ != ptr) {
-            Clear();
-        }
-        block_ = *(new ControlBlockPtr<T>(ptr));
-        observed_ = ptr;
+        SharedPtr(ptr).Swap(*this);
     }
 
     template <typename U>
     void Reset(U* ptr) {
-
         if (observed_ == ptr) {
             return;
         }
-        if (observed_ != ptr) {
-            Clear();
-        }
-        block_ = *(new ControlBlockPtr<U>(ptr));
-        observed_ = ptr;
+        SharedPtr(ptr).Swap(*this);
+    }
+
+    template <typename U, typename Deleter>
+    void Reset(U* ptr, Deleter deleter) {
+        SharedPtr(ptr, std::move(deleter)).Swap(*this);
     }
 
     void Swap(SharedPtr& other) {
@@ -357,6 +334,18 @@ private:
     ControlBlock* block_ = nullptr;
     T* observed_ = nullptr;
 
+    // Owns `ptr` from the call on: if the block cannot be made, `deleter` frees `ptr` before the
+    // exception leaves
+    template <typename U, typename Deleter>
+    static ControlBlock* NewOwningBlock(U* ptr, Deleter deleter) {
+        try {
+            return *(new ControlBlockPtr<U, Deleter>(ptr, deleter));
+        } catch (...) {
+            deleter(ptr);
+            throw;
+        }
+    }
+
     ControlBlock*& GetBlock() {
         return block_;
     }
@@ -108,11 +108,12 @@ public:
         return (block_->GetStrongCount() == 0);
     }
     SharedPtr<T> Lock() const {
-        if (!Expired()) {
-            return SharedPtr<T>(*this);
-        } else {
-            return SharedPtr<T>();
+        SharedPtr<T> result;
+        if (block_ != nullptr && block_->TryIncStrong()) {
+            result.block_ = block_;
+            result.observed_ = observed_;
         }
+        return result;
     }
 
 private: